@@ -0,0 +1,209 @@
+#include "AudioReader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const uint16_t kFormatPcm = 1;
+const uint16_t kFormatFloat = 3;
+const uint16_t kFormatExtensible = 0xFFFE;
+
+uint16_t ReadLe16(const unsigned char *bytes) {
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t ReadLe32(const unsigned char *bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+bool IsWavPath(const std::string &path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return false;
+
+    std::string extension = path.substr(dot + 1);
+    for (char &c : extension) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return extension == "wav" || extension == "wave";
+}
+
+} // namespace
+
+AudioReader::~AudioReader() {
+    Close();
+}
+
+bool AudioReader::Open(const std::string &path, float rawSampleRate, std::string &error) {
+    Close();
+
+    mFile = fopen(path.c_str(), "rb");
+    if (!mFile) {
+        error = strerror(errno);
+        return false;
+    }
+
+    if (IsWavPath(path)) {
+        if (!ReadWavHeader(error)) {
+            Close();
+            return false;
+        }
+    } else {
+        mEncoding = Encoding::Float32;
+        mChannels = 1;
+        mBytesPerSample = 4;
+        mSampleRate = rawSampleRate;
+        mRemaining = -1;
+    }
+    return true;
+}
+
+void AudioReader::Close() {
+    if (mFile) {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+int AudioReader::Read(float *buffer, int maxFrames) {
+    if (!mFile || maxFrames <= 0) return 0;
+
+    size_t frameBytes = (size_t)mChannels * mBytesPerSample;
+    size_t wanted = (size_t)maxFrames * frameBytes;
+    if (mRemaining >= 0) {
+        wanted = std::min(wanted, (size_t)mRemaining / frameBytes * frameBytes);
+    }
+    if (mBytes.size() < wanted) {
+        mBytes.resize(wanted);
+    }
+
+    size_t got = fread(mBytes.data(), 1, wanted, mFile);
+    int frames = (int)(got / frameBytes);
+    if (mRemaining >= 0) {
+        mRemaining -= (long long)frames * frameBytes;
+    }
+
+    // Downmix by averaging the channels
+    float scale = 1.0f / mChannels;
+    const unsigned char *bytes = mBytes.data();
+    for (int i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < mChannels; ++c) {
+            sum += Decode(bytes);
+            bytes += mBytesPerSample;
+        }
+        buffer[i] = sum * scale;
+    }
+    return frames;
+}
+
+bool AudioReader::ReadWavHeader(std::string &error) {
+    unsigned char header[12];
+    if (fread(header, 1, sizeof(header), mFile) != sizeof(header)
+        || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        error = "not a RIFF/WAVE file";
+        return false;
+    }
+
+    bool haveFormat = false;
+    while (true) {
+        unsigned char chunk[8];
+        if (fread(chunk, 1, sizeof(chunk), mFile) != sizeof(chunk)) {
+            error = haveFormat ? "no data chunk" : "no fmt chunk";
+            return false;
+        }
+        uint32_t size = ReadLe32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char format[40] = {};
+            size_t take = std::min((size_t)size, sizeof(format));
+            if (size < 16 || fread(format, 1, take, mFile) != take) {
+                error = "truncated fmt chunk";
+                return false;
+            }
+
+            uint16_t tag = ReadLe16(format);
+            mChannels = ReadLe16(format + 2);
+            mSampleRate = (float)ReadLe32(format + 4);
+            int bits = ReadLe16(format + 14);
+            // The sub-format GUID starts with the plain format tag
+            if (tag == kFormatExtensible && size >= 40) {
+                tag = ReadLe16(format + 24);
+            }
+
+            if (tag == kFormatPcm && bits == 8) {
+                mEncoding = Encoding::Pcm8;
+            } else if (tag == kFormatPcm && bits == 16) {
+                mEncoding = Encoding::Pcm16;
+            } else if (tag == kFormatPcm && bits == 24) {
+                mEncoding = Encoding::Pcm24;
+            } else if (tag == kFormatPcm && bits == 32) {
+                mEncoding = Encoding::Pcm32;
+            } else if (tag == kFormatFloat && bits == 32) {
+                mEncoding = Encoding::Float32;
+            } else if (tag == kFormatFloat && bits == 64) {
+                mEncoding = Encoding::Float64;
+            } else {
+                error = "unsupported format " + std::to_string(tag) + " with " + std::to_string(bits) + " bits";
+                return false;
+            }
+            mBytesPerSample = bits / 8;
+
+            if (mChannels < 1 || mSampleRate <= 0.0f) {
+                error = "bad channel count or sample rate";
+                return false;
+            }
+
+            // Skip the rest of a longer chunk and the pad byte
+            long skip = (long)(size - take) + (size & 1);
+            if (skip > 0 && fseek(mFile, skip, SEEK_CUR) != 0) {
+                error = "truncated fmt chunk";
+                return false;
+            }
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                error = "data before fmt chunk";
+                return false;
+            }
+            // Streaming writers leave the size at 0 or all ones
+            mRemaining = (size == 0 || size == 0xFFFFFFFF) ? -1 : (long long)size;
+            return true;
+        } else if (fseek(mFile, (long)size + (size & 1), SEEK_CUR) != 0) {
+            error = "truncated chunk";
+            return false;
+        }
+    }
+}
+
+float AudioReader::Decode(const unsigned char *bytes) const {
+    switch (mEncoding) {
+        case Encoding::Pcm8:
+            return (bytes[0] - 128) / 128.0f;
+        case Encoding::Pcm16:
+            return (int16_t)ReadLe16(bytes) / 32768.0f;
+        case Encoding::Pcm24: {
+            // Put the 24 bits at the top so the sign comes along
+            int32_t value = (int32_t)(((uint32_t)bytes[0] << 8) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 24));
+            return (value >> 8) / 8388608.0f;
+        }
+        case Encoding::Pcm32:
+            return (int32_t)ReadLe32(bytes) / 2147483648.0f;
+        case Encoding::Float32: {
+            uint32_t bits = ReadLe32(bytes);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        case Encoding::Float64: {
+            uint64_t bits = ReadLe32(bytes) | ((uint64_t)ReadLe32(bytes + 4) << 32);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return (float)value;
+        }
+    }
+    return 0.0f;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Streams a recording as mono float samples, a block at a time, so memory
+// stays the same whatever the file's length. Reads WAV (8, 16, 24 and 32 bit
+// PCM, 32 and 64 bit float, any channel count, downmixed) and raw mono
+// float32 for any other extension.
+class AudioReader {
+public:
+    AudioReader() = default;
+    ~AudioReader();
+
+    AudioReader(const AudioReader&) = delete;
+    AudioReader& operator=(const AudioReader&) = delete;
+
+    // rawSampleRate is the rate assumed for raw float32 files. On failure
+    // error says why.
+    bool Open(const std::string &path, float rawSampleRate, std::string &error);
+    void Close();
+
+    // Reads up to maxFrames, returns how many, 0 at the end
+    int Read(float *buffer, int maxFrames);
+
+    inline float GetSampleRate() const {
+        return mSampleRate;
+    }
+
+private:
+    enum class Encoding {
+        Pcm8,
+        Pcm16,
+        Pcm24,
+        Pcm32,
+        Float32,
+        Float64,
+    };
+
+    FILE *mFile = nullptr;
+    Encoding mEncoding = Encoding::Float32;
+    int mChannels = 1;
+    int mBytesPerSample = 4;
+    float mSampleRate = 0.0f;
+    // Audio bytes left in the data chunk, or -1 to read until the end
+    long long mRemaining = -1;
+    std::vector<unsigned char> mBytes;
+
+    bool ReadWavHeader(std::string &error);
+    float Decode(const unsigned char *bytes) const;
+};
@@ -0,0 +1,227 @@
+#include "BatchAnalyzer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "AudioReader.hpp"
+#include "Note.hpp"
+
+namespace {
+
+// Frames read from a file at a time, the pipeline cuts them into blocks
+constexpr int kReadFrames = 4096;
+
+// What one worker reuses from file to file
+struct Worker {
+    AudioReader reader;
+    Tuner::Pipeline pipeline;
+    std::vector<float> block;
+    // Detected windows per note and their cents, for the file at hand
+    std::vector<long long> noteCounts;
+    std::vector<CentsStats> noteCents;
+    // Stage timings of the files done so far
+    std::vector<Tuner::StageTiming> timings;
+};
+
+void AnalyzeFile(const BatchFile &file, const BatchOptions &options, Worker &worker, FileReport &report) {
+    report.path = file.path;
+    if (!worker.reader.Open(file.path, options.rawSampleRate, report.error)) {
+        return;
+    }
+
+    Tuner::AnalyzerConfig config = options.analyzer;
+    config.sampleRate = worker.reader.GetSampleRate();
+
+    const auto& notes = GetChromaticNotes();
+    std::fill(worker.noteCounts.begin(), worker.noteCounts.end(), 0);
+    std::fill(worker.noteCents.begin(), worker.noteCents.end(), CentsStats());
+
+    // The publish stage sees every analyzed window, on the detect thread
+    // when pipelined. Flush below hands its counts back to this one.
+    worker.pipeline.Clear();
+    Tuner::StageRun detectRun = options.pipelined ? Tuner::StageRun::Thread : Tuner::StageRun::Inline;
+    Tuner::AddAnalysisStages(worker.pipeline, config, detectRun, [&](const Tuner::Reading &reading) {
+        if (!reading.voiced) return;
+
+        ++report.voiced;
+        if (!reading.note) return;
+
+        ++report.detected;
+        int note = (int)(reading.note - notes.data());
+        ++worker.noteCounts[note];
+        worker.noteCents[note].Add(reading.centsOff);
+    });
+    Tuner::PipelineFormat format;
+    format.sampleRate = config.sampleRate;
+    format.maxBlock = Tuner::kAnalysisBlock;
+    worker.pipeline.Prepare(format);
+
+    long long frames = 0;
+    int count;
+    while ((count = worker.reader.Read(worker.block.data(), (int)worker.block.size())) > 0) {
+        frames += count;
+        worker.pipeline.PushWaiting(worker.block.data(), count);
+    }
+    worker.pipeline.Flush();
+    worker.reader.Close();
+    report.seconds = frames / (double)config.sampleRate;
+    MergeTimings(worker.timings, worker.pipeline.GetTimings());
+
+    report.expected = file.expectedNote >= 0;
+    report.note = file.expectedNote;
+    if (!report.expected && report.detected > 0) {
+        report.note = (int)(std::max_element(worker.noteCounts.begin(), worker.noteCounts.end())
+            - worker.noteCounts.begin());
+    }
+    if (report.note < 0) return;
+
+    for (int note = 0; note < (int)notes.size(); ++note) {
+        int distance = note - report.note;
+        if (distance == 0) {
+            report.cents = worker.noteCents[note];
+        } else if (distance % 12 == 0) {
+            report.octaveErrors += worker.noteCounts[note];
+        } else {
+            report.otherNotes += worker.noteCounts[note];
+        }
+    }
+}
+
+} // namespace
+
+void MergeTimings(std::vector<Tuner::StageTiming> &timings, const std::vector<Tuner::StageTiming> &other) {
+    if (timings.empty()) {
+        timings = other;
+        return;
+    }
+
+    // Same stages in the same order, every file gets the same pipeline
+    for (size_t i = 0; i < timings.size() && i < other.size(); ++i) {
+        Tuner::StageTiming &timing = timings[i];
+        long long blocks = timing.blocks + other[i].blocks;
+        if (blocks > 0) {
+            timing.meanUs = (timing.meanUs * timing.blocks + other[i].meanUs * other[i].blocks) / blocks;
+        }
+        timing.blocks = blocks;
+        timing.maxUs = std::max(timing.maxUs, other[i].maxUs);
+    }
+}
+
+void CentsStats::Add(double cents) {
+    // Welford
+    ++count;
+    double delta = cents - mean;
+    mean += delta / count;
+    m2 += delta * (cents - mean);
+}
+
+void CentsStats::Merge(const CentsStats &other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+
+    // Chan et al., pairwise combination of two Welford states
+    long long total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * count * other.count / total;
+    count = total;
+}
+
+double CentsStats::GetStd() const {
+    return count > 1 ? sqrt(m2 / (count - 1)) : 0.0;
+}
+
+std::vector<FileReport> AnalyzeFiles(const std::vector<BatchFile> &files, const BatchOptions &options,
+    std::vector<Tuner::StageTiming> *timings) {
+    std::vector<FileReport> reports(files.size());
+    std::atomic<size_t> next{0};
+    std::mutex timingsMutex;
+
+    // Files are handed out one at a time, so a long one doesn't hold up a
+    // whole share of the list
+    auto work = [&]() {
+        Worker worker;
+        worker.block.resize(kReadFrames);
+        worker.noteCounts.resize(GetChromaticNotes().size());
+        worker.noteCents.resize(GetChromaticNotes().size());
+
+        size_t index;
+        while ((index = next.fetch_add(1)) < files.size()) {
+            AnalyzeFile(files[index], options, worker, reports[index]);
+        }
+
+        if (timings) {
+            std::lock_guard<std::mutex> lock(timingsMutex);
+            MergeTimings(*timings, worker.timings);
+        }
+    };
+
+    int threads = std::max(1, std::min(options.threads, (int)files.size()));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return reports;
+}
+
+std::vector<NoteReport> SummarizeByNote(const std::vector<FileReport> &reports) {
+    std::map<int, NoteReport> byNote;
+    for (const auto& report : reports) {
+        if (!report.error.empty() || report.note < 0) continue;
+
+        NoteReport &summary = byNote[report.note];
+        summary.note = report.note;
+        ++summary.files;
+        summary.voiced += report.voiced;
+        summary.detected += report.detected;
+        summary.octaveErrors += report.octaveErrors;
+        summary.otherNotes += report.otherNotes;
+        summary.cents.Merge(report.cents);
+    }
+
+    std::vector<NoteReport> summaries;
+    for (const auto& entry : byNote) {
+        summaries.push_back(entry.second);
+    }
+    return summaries;
+}
+
+int ParseNoteName(const std::string &name) {
+    static const int kSemitones[] = {9, 11, 0, 2, 4, 5, 7}; // A to G
+    if (name.size() < 2) return -1;
+
+    char letter = (char)toupper((unsigned char)name[0]);
+    if (letter < 'A' || letter > 'G') return -1;
+    int semitone = kSemitones[letter - 'A'];
+
+    size_t i = 1;
+    if (name[i] == '#') {
+        ++semitone;
+        ++i;
+    } else if (name[i] == 'b') {
+        --semitone;
+        ++i;
+    }
+
+    if (i == name.size()) return -1;
+    int octave = 0;
+    for (; i < name.size(); ++i) {
+        if (!isdigit((unsigned char)name[i])) return -1;
+        octave = octave * 10 + (name[i] - '0');
+    }
+
+    int note = octave * 12 + semitone;
+    return note >= 0 && note < (int)GetChromaticNotes().size() ? note : -1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Analyzer.hpp"
+
+struct BatchFile {
+    std::string path;
+    // Index into GetChromaticNotes the recording should be, -1 when unknown.
+    // Unknown files are judged against the note they read as most often.
+    int expectedNote = -1;
+};
+
+struct BatchOptions {
+    int threads = 1;
+    // Sample rate of raw float32 files, WAV files carry their own
+    float rawSampleRate = 44100.0f;
+    // Everything but the sample rate, which comes from each file
+    Tuner::AnalyzerConfig analyzer;
+    // Run detection on a thread of its own behind reading, filtering and
+    // gating, two threads per worker
+    bool pipelined = false;
+};
+
+// Running mean and variance of cents readings that can be merged
+struct CentsStats {
+    long long count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void Add(double cents);
+    void Merge(const CentsStats &other);
+    double GetStd() const;
+};
+
+// Every analyzed window that passed the gate counts as voiced, and as
+// detected when it gave a note. Detected windows are on the reference note,
+// a whole number of octaves off it, or on some other note.
+struct FileReport {
+    std::string path;
+    // Empty when the file was read to the end
+    std::string error;
+    double seconds = 0.0;
+    // Reference note, -1 when nothing was detected and none was expected
+    int note = -1;
+    bool expected = false;
+    long long voiced = 0;
+    long long detected = 0;
+    long long octaveErrors = 0;
+    long long otherNotes = 0;
+    // Cents off the reference note, for the windows on it
+    CentsStats cents;
+};
+
+// Files with the same reference note taken together
+struct NoteReport {
+    int note = -1;
+    int files = 0;
+    long long voiced = 0;
+    long long detected = 0;
+    long long octaveErrors = 0;
+    long long otherNotes = 0;
+    CentsStats cents;
+};
+
+// Analyzes the files on options.threads workers, each streaming one file at
+// a time through its own pipeline of the analysis stages. Memory depends on
+// the worker count and window size, not on the files. Reports come back in
+// the order of files, timings when given gets the stage timings summed over
+// all of them.
+std::vector<FileReport> AnalyzeFiles(const std::vector<BatchFile> &files, const BatchOptions &options,
+    std::vector<Tuner::StageTiming> *timings = nullptr);
+
+// Adds other's blocks and times into timings, both of the same pipeline
+void MergeTimings(std::vector<Tuner::StageTiming> &timings, const std::vector<Tuner::StageTiming> &other);
+
+// Per reference note, lowest first, files that failed to read are left out
+std::vector<NoteReport> SummarizeByNote(const std::vector<FileReport> &reports);
+
+// Index into GetChromaticNotes for a name like E2, F#3 or Eb2, -1 if it
+// isn't one
+int ParseNoteName(const std::string &name);
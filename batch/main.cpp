@@ -0,0 +1,328 @@
+// Offline intonation checks over many recordings. Every file is analyzed
+// with the same engine the tuner runs, and the readings are summed up per
+// file and per note: cents off the reference note, how often a note was
+// detected at all and how often it came out a whole octave off.
+//
+//   darktuna_batch recordings/
+//   darktuna_batch --manifest nightly.txt --threads 16 --csv results/nightly
+//
+// A manifest lists one file per line, optionally followed by the note it
+// should be. In directories, WAV and raw float32 (.f32) files are picked up
+// recursively and a note name among the words of the file name, as in
+// bass_E1_take3.wav, is taken as the expected note. Without one, each file
+// is judged against the note it read as most often.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchAnalyzer.hpp"
+#include "Note.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Arguments {
+    std::vector<std::string> inputs;
+    std::vector<std::string> manifests;
+    std::string csvPrefix;
+    bool quiet = false;
+    bool timings = false;
+    BatchOptions options;
+};
+
+void PrintUsage() {
+    fprintf(stderr,
+        "usage: darktuna_batch [options] [file or directory ...]\n"
+        "  --manifest PATH       read the files and expected notes from a list, repeatable\n"
+        "  --threads N           worker threads (default: all cores)\n"
+        "  --detector NAME       pitch detector (default Auto)\n"
+        "  --accumulation M      Float, Mixed, Pairwise, Kahan, Double or Int16 (default Float)\n"
+        "  --window N            samples per analysis (default 2048)\n"
+        "  --hop N               samples between analyses (default 2048)\n"
+        "  --raw-sample-rate HZ  sample rate of .f32 files (default 44100)\n"
+        "  --decimate            halve the sample rate ahead of the detector, window and hop are then\n"
+        "                        at the lower rate\n"
+        "  --pipelined           run detection on a second thread per worker\n"
+        "  --timings             print the time spent in each pipeline stage\n"
+        "  --csv PREFIX          also write PREFIX.files.csv and PREFIX.notes.csv\n"
+        "  --quiet               leave out the per-file table\n");
+}
+
+bool ParseArguments(int argc, char **argv, Arguments &args) {
+    Tuner::AnalyzerConfig &analyzer = args.options.analyzer;
+    args.options.threads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--quiet") {
+            args.quiet = true;
+        } else if (arg == "--timings") {
+            args.timings = true;
+        } else if (arg == "--pipelined") {
+            args.options.pipelined = true;
+        } else if (arg == "--decimate") {
+            analyzer.decimate = true;
+        } else if (arg.compare(0, 2, "--") != 0) {
+            args.inputs.push_back(arg);
+        } else if (!hasValue) {
+            return false;
+        } else if (arg == "--manifest") {
+            args.manifests.push_back(argv[++i]);
+        } else if (arg == "--threads") {
+            args.options.threads = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--window") {
+            analyzer.windowSize = atoi(argv[++i]);
+        } else if (arg == "--hop") {
+            analyzer.hopSize = atoi(argv[++i]);
+        } else if (arg == "--raw-sample-rate") {
+            args.options.rawSampleRate = (float)atof(argv[++i]);
+        } else if (arg == "--csv") {
+            args.csvPrefix = argv[++i];
+        } else if (arg == "--detector") {
+            if (!Tuner::ParseDetector(argv[++i], analyzer.detector)) {
+                fprintf(stderr, "darktuna_batch: unknown detector %s\n", argv[i]);
+                return false;
+            }
+        } else if (arg == "--accumulation") {
+            if (!Tuner::ParseAccumulation(argv[++i], analyzer.accumulation)) {
+                fprintf(stderr, "darktuna_batch: unknown accumulation mode %s\n", argv[i]);
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (analyzer.windowSize < 64 || analyzer.hopSize <= 0 || args.options.rawSampleRate <= 0.0f) {
+        fprintf(stderr, "darktuna_batch: bad window, hop or sample rate\n");
+        return false;
+    }
+    return !args.inputs.empty() || !args.manifests.empty();
+}
+
+bool IsAudioPath(const fs::path &path) {
+    std::string extension = path.extension().string();
+    for (char &c : extension) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return extension == ".wav" || extension == ".wave" || extension == ".f32";
+}
+
+// First word of the file name that is a note name
+int GuessNote(const fs::path &path) {
+    std::string stem = path.stem().string();
+    size_t begin = 0;
+    while (begin < stem.size()) {
+        size_t end = stem.find_first_of("_-. ", begin);
+        if (end == std::string::npos) end = stem.size();
+
+        int note = ParseNoteName(stem.substr(begin, end - begin));
+        if (note >= 0) return note;
+        begin = end + 1;
+    }
+    return -1;
+}
+
+bool AddInput(const std::string &input, std::vector<BatchFile> &files) {
+    std::error_code error;
+    if (!fs::is_directory(input, error)) {
+        files.push_back({input, GuessNote(input)});
+        return true;
+    }
+
+    std::vector<fs::path> found;
+    for (fs::recursive_directory_iterator it(input, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error) && IsAudioPath(it->path())) {
+            found.push_back(it->path());
+        }
+    }
+    if (error) {
+        fprintf(stderr, "darktuna_batch: can't read %s: %s\n", input.c_str(), error.message().c_str());
+        return false;
+    }
+
+    // Directory order is arbitrary, keep the reports stable between runs
+    std::sort(found.begin(), found.end());
+    for (const auto& path : found) {
+        files.push_back({path.string(), GuessNote(path)});
+    }
+    return true;
+}
+
+// Lines are a path, optionally followed by the expected note. Relative
+// paths are relative to the manifest, lines starting with # are comments.
+bool AddManifest(const std::string &manifest, std::vector<BatchFile> &files) {
+    std::ifstream stream(manifest);
+    if (!stream) {
+        fprintf(stderr, "darktuna_batch: can't open manifest %s\n", manifest.c_str());
+        return false;
+    }
+
+    fs::path base = fs::path(manifest).parent_path();
+    std::string line;
+    while (std::getline(stream, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#') continue;
+
+        // The last word is the note if it reads as one, paths may have spaces
+        int note = -1;
+        size_t space = line.find_last_of(" \t");
+        if (space != std::string::npos) {
+            note = ParseNoteName(line.substr(space + 1));
+            if (note >= 0) {
+                line.erase(line.find_last_not_of(" \t", space) + 1);
+            }
+        }
+
+        fs::path path = line;
+        if (path.is_relative()) path = base / path;
+        files.push_back({path.string(), note});
+    }
+    return true;
+}
+
+double Percent(long long part, long long whole) {
+    return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+// Note name, with a ? when it was inferred rather than expected
+std::string GetNoteLabel(int note, bool expected) {
+    if (note < 0) return "-";
+    return GetChromaticNotes()[note].name + (expected ? "" : "?");
+}
+
+void PrintFileTable(const std::vector<FileReport> &reports) {
+    printf("%-40s %8s %5s %7s %7s %7s %7s %8s %8s\n",
+        "file", "seconds", "note", "voiced", "detect", "octave", "other", "mean c", "std c");
+    for (const auto& report : reports) {
+        if (!report.error.empty()) {
+            printf("%-40s error: %s\n", report.path.c_str(), report.error.c_str());
+            continue;
+        }
+        printf("%-40s %8.1f %5s %7lld %6.1f%% %6.1f%% %6.1f%% %+8.2f %8.2f\n",
+            report.path.c_str(), report.seconds, GetNoteLabel(report.note, report.expected).c_str(),
+            report.voiced, Percent(report.detected, report.voiced),
+            Percent(report.octaveErrors, report.detected), Percent(report.otherNotes, report.detected),
+            report.cents.mean, report.cents.GetStd());
+    }
+    printf("\n");
+}
+
+void PrintNoteTable(const std::vector<NoteReport> &notes) {
+    printf("%-5s %6s %8s %7s %7s %7s %8s %8s\n",
+        "note", "files", "voiced", "detect", "octave", "other", "mean c", "std c");
+    for (const auto& note : notes) {
+        printf("%-5s %6d %8lld %6.1f%% %6.1f%% %6.1f%% %+8.2f %8.2f\n",
+            GetChromaticNotes()[note.note].name.c_str(), note.files, note.voiced,
+            Percent(note.detected, note.voiced), Percent(note.octaveErrors, note.detected),
+            Percent(note.otherNotes, note.detected), note.cents.mean, note.cents.GetStd());
+    }
+}
+
+// To stderr with the run summary, they differ from run to run
+void PrintTimings(const std::vector<Tuner::StageTiming> &timings) {
+    static const char *runNames[] = {"inline", "thread", "pump"};
+    fprintf(stderr, "\n%-10s %-7s %10s %9s %9s\n", "stage", "run", "blocks", "mean us", "max us");
+    for (const auto& timing : timings) {
+        fprintf(stderr, "%-10s %-7s %10lld %9.2f %9.1f\n", timing.name, runNames[(int)timing.run],
+            timing.blocks, timing.meanUs, timing.maxUs);
+    }
+}
+
+bool WriteCsv(const std::string &prefix, const std::vector<FileReport> &reports, const std::vector<NoteReport> &notes) {
+    std::string filesPath = prefix + ".files.csv";
+    std::string notesPath = prefix + ".notes.csv";
+    std::ofstream files(filesPath);
+    std::ofstream byNote(notesPath);
+    if (!files || !byNote) {
+        fprintf(stderr, "darktuna_batch: can't write %s\n", (files ? notesPath : filesPath).c_str());
+        return false;
+    }
+
+    files << "file,error,seconds,note,expected,voiced,detected,octave_errors,other_notes,on_note,mean_cents,std_cents\n";
+    for (const auto& report : reports) {
+        // Quote the path and error, doubling any quotes in them
+        auto quote = [](std::string text) {
+            for (size_t i = text.find('"'); i != std::string::npos; i = text.find('"', i + 2)) {
+                text.insert(i, 1, '"');
+            }
+            return "\"" + text + "\"";
+        };
+        files << quote(report.path) << ',' << quote(report.error) << ',' << report.seconds << ','
+            << (report.note >= 0 ? GetChromaticNotes()[report.note].name : "") << ','
+            << (report.expected ? 1 : 0) << ',' << report.voiced << ',' << report.detected << ','
+            << report.octaveErrors << ',' << report.otherNotes << ',' << report.cents.count << ','
+            << report.cents.mean << ',' << report.cents.GetStd() << '\n';
+    }
+
+    byNote << "note,files,voiced,detected,octave_errors,other_notes,on_note,mean_cents,std_cents\n";
+    for (const auto& note : notes) {
+        byNote << GetChromaticNotes()[note.note].name << ',' << note.files << ',' << note.voiced << ','
+            << note.detected << ',' << note.octaveErrors << ',' << note.otherNotes << ','
+            << note.cents.count << ',' << note.cents.mean << ',' << note.cents.GetStd() << '\n';
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Arguments args;
+    if (!ParseArguments(argc, argv, args)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<BatchFile> files;
+    for (const auto& manifest : args.manifests) {
+        if (!AddManifest(manifest, files)) return 1;
+    }
+    for (const auto& input : args.inputs) {
+        if (!AddInput(input, files)) return 1;
+    }
+    if (files.empty()) {
+        fprintf(stderr, "darktuna_batch: no audio files found\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Tuner::StageTiming> timings;
+    std::vector<FileReport> reports = AnalyzeFiles(files, args.options, &timings);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<NoteReport> notes = SummarizeByNote(reports);
+
+    if (!args.quiet) {
+        PrintFileTable(reports);
+    }
+    PrintNoteTable(notes);
+
+    double audio = 0.0;
+    int failed = 0;
+    for (const auto& report : reports) {
+        audio += report.seconds;
+        failed += report.error.empty() ? 0 : 1;
+    }
+    fflush(stdout);
+    fprintf(stderr, "\n%d files, %d failed, %.0f s of audio in %.2f s on %d threads, %.0fx real time\n",
+        (int)files.size(), failed, audio, elapsed, args.options.threads, elapsed > 0.0 ? audio / elapsed : 0.0);
+    if (args.timings) {
+        PrintTimings(timings);
+    }
+
+    if (!args.csvPrefix.empty() && !WriteCsv(args.csvPrefix, reports, notes)) {
+        return 1;
+    }
+    return failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,444 @@
+// Micro benchmarks for the analysis engine. Each entry reports the time per
+// call and how much of the real-time budget for the audio it processed that
+// is. Pass a substring to only run matching entries:
+//
+//   darktuna_bench [filter]
+//
+// --accuracy instead compares every accumulation mode against a long double
+// reference on long windows, with the time each one takes, then checks the
+// int16 detectors against the float ones on a corpus of notes and counts
+// the readings the analysis pipeline publishes. It fails when the int16
+// detectors drift further apart than kFixedPointCentsBound or a reading
+// goes missing:
+//
+//   darktuna_bench --accuracy
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Analyzer.hpp"
+#include "Correlation.hpp"
+#include "FixedPoint.hpp"
+#include "NoiseGate.hpp"
+#include "PitchDetector.hpp"
+#include "PreFilter.hpp"
+#include "Strobe.hpp"
+
+namespace {
+
+const float kSampleRate = 44100.0f;
+const int kBlockSize = 512;
+const int kWindowSize = 2048;
+const int kMaxWindowSize = 8192;
+
+struct Benchmark {
+    std::string name;
+    // Samples of audio one call handles, used for the real-time ratio
+    int samples;
+    std::function<void()> run;
+};
+
+// Low E string with harmonics, mains hum, a DC offset and some noise
+std::vector<float> MakeSignal(int size, float frequency) {
+    const float pi = 3.14159265f;
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+
+    std::vector<float> signal(size);
+    for (int i = 0; i < size; ++i) {
+        float t = i / kSampleRate;
+        signal[i] = 0.02f
+            + 0.10f * sinf(2.0f * pi * frequency * t)
+            + 0.05f * sinf(2.0f * pi * 2.0f * frequency * t + 0.5f)
+            + 0.03f * sinf(2.0f * pi * 3.0f * frequency * t + 1.0f)
+            + 0.01f * sinf(2.0f * pi * 50.0f * t)
+            + noise(rng);
+    }
+    return signal;
+}
+
+// The per-lag loop the detectors used before the kernels, as a baseline
+void CorrelateScalar(const float *buffer, int size, int beginLag, int endLag, float *correlation) {
+    for (int lag = beginLag; lag < endLag; ++lag) {
+        float sum = 0.0f;
+        for (int i = 0; i < size - lag; ++i) {
+            sum += buffer[i] * buffer[i + lag];
+        }
+        correlation[lag] = sum;
+    }
+}
+
+// Lowercase mode name for entry names
+std::string GetModeName(const Tuner::AccumulationInfo &info) {
+    std::string name = info.name;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return name;
+}
+
+// Runs the entry until it has been timed for long enough, returns seconds per call
+double Measure(const Benchmark &benchmark) {
+    using Clock = std::chrono::steady_clock;
+    const double kMinSeconds = 0.25;
+
+    for (int i = 0; i < 3; ++i) {
+        benchmark.run();
+    }
+
+    long long calls = 0;
+    double elapsed = 0.0;
+    long long batch = 1;
+    while (elapsed < kMinSeconds) {
+        auto start = Clock::now();
+        for (long long i = 0; i < batch; ++i) {
+            benchmark.run();
+        }
+        elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+        calls += batch;
+        batch *= 2;
+    }
+    return elapsed / calls;
+}
+
+// Error of every accumulation mode on a raw drop A low string (A1 with the
+// DC offset of an interface without the pre-filter) at growing window sizes.
+// The reference sums in long double one lag at a time.
+int RunAccuracyReport() {
+    const float kFrequency = 55.0f;
+    const float kOffset = 0.25f;
+
+    printf("%-10s %7s %12s %14s %14s %12s\n",
+        "mode", "window", "time/call", "max lag error", "energy error", "cents error");
+    for (int size : {2048, 8192, 32768}) {
+        std::vector<float> signal = MakeSignal(size, kFrequency);
+        for (float &sample : signal) {
+            sample += kOffset;
+        }
+
+        Tuner::PeriodPicker picker;
+        picker.Prepare(kSampleRate, size);
+        int minLag = std::max(2, (int)(kSampleRate / Tuner::kMaxFrequency));
+        int maxLag = std::min(size / 2, (int)ceilf(kSampleRate / Tuner::kMinFrequency));
+
+        // Reference, rounded to float like every mode's correlation is. The
+        // energy comes back in double and is compared unrounded.
+        std::vector<float> reference(maxLag);
+        double referenceEnergy = 0.0;
+        for (int lag = 0; lag < maxLag; ++lag) {
+            long double sum = 0.0L;
+            for (int i = 0; i < size - lag; ++i) {
+                sum += (long double)signal[i] * signal[i + lag];
+            }
+            reference[lag] = (float)sum;
+            if (lag == 0) {
+                referenceEnergy = (double)sum;
+            }
+        }
+        picker.SetAccumulation(Tuner::Accumulation::Double);
+        float referenceFrequency = picker.Pick(signal.data(), size, reference.data(), minLag, maxLag).frequency;
+
+        std::vector<float> correlation(maxLag);
+        std::vector<int16_t> scratch(size);
+        auto report = [&](const char *name, Tuner::Accumulation accumulation, std::function<void()> correlate,
+            double energy) {
+            double seconds = Measure({"", size, correlate});
+
+            // Relative to the energy, the largest value the correlation takes
+            double worst = 0.0;
+            for (int lag = 0; lag < maxLag; ++lag) {
+                worst = std::max(worst, fabs((double)correlation[lag] - reference[lag]));
+            }
+            worst /= reference[0];
+            double energyError = fabs(energy - referenceEnergy) / referenceEnergy;
+
+            picker.Reset();
+            picker.SetAccumulation(accumulation);
+            float frequency = picker.Pick(signal.data(), size, correlation.data(), minLag, maxLag).frequency;
+            float cents = frequency > 0.0f && referenceFrequency > 0.0f
+                ? 1200.0f * log2f(frequency / referenceFrequency) : 0.0f;
+
+            printf("%-10s %7d %9.2f us %14.3e %14.3e %12.5f\n",
+                name, size, seconds * 1e6, worst, energyError, fabsf(cents));
+        };
+
+        // The one sum per lag loop the detectors used before the kernels
+        float scalarEnergy = 0.0f;
+        for (float sample : signal) {
+            scalarEnergy += sample * sample;
+        }
+        report("Scalar", Tuner::Accumulation::Float, [&]() {
+            CorrelateScalar(signal.data(), size, 0, maxLag, correlation.data());
+        }, scalarEnergy);
+
+        for (const auto& info : Tuner::GetAccumulationModes()) {
+            Tuner::Accumulation accumulation = info.accumulation;
+            report(info.name, accumulation, [&]() {
+                Tuner::Correlate(signal.data(), size, 0, maxLag, correlation.data(), accumulation,
+                    scratch.data());
+            }, Tuner::SumSquares(signal.data(), size, accumulation));
+        }
+    }
+    return 0;
+}
+
+// Every note from E1 to B4, 40 cents flat to 40 sharp, at full scale down to
+// -50 dB, through the correlation detectors in float and in int16. Returns
+// non-zero when an int16 reading is further than kFixedPointCentsBound from
+// the float one, or lands on another note.
+int RunFixedPointReport() {
+    const float pi = 3.14159265f;
+    const float kLevels[] = {1.0f, 0.1f, 0.003f};
+
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 0.005f);
+    std::uniform_real_distribution<float> phase(0.0f, 2.0f * pi);
+
+    int failures = 0;
+    printf("\n%-16s %7s %8s %12s %12s %10s\n", "int16 detector", "window", "readings", "worst cents", "mean cents", "mismatches");
+    for (Tuner::DetectorType type : {Tuner::DetectorType::Autocorrelation, Tuner::DetectorType::Nsdf}) {
+        for (int size : {kWindowSize, kMaxWindowSize}) {
+            auto floatDetector = Tuner::CreateDetector(type);
+            auto fixedDetector = Tuner::CreateDetector(type);
+            floatDetector->Prepare(kSampleRate, size);
+            fixedDetector->Prepare(kSampleRate, size);
+            fixedDetector->SetAccumulation(Tuner::Accumulation::FixedPoint);
+
+            std::vector<float> signal(size);
+            int readings = 0;
+            int mismatches = 0;
+            double worst = 0.0;
+            double total = 0.0;
+            for (int midi = 28; midi <= 71; ++midi) {
+                for (float detune = -40.0f; detune <= 40.0f; detune += 20.0f) {
+                    for (float level : kLevels) {
+                        // Six harmonics falling off as 1/n, with random phases
+                        float frequency = 440.0f * powf(2.0f, (midi - 69 + detune / 100.0f) / 12.0f);
+                        if (frequency > Tuner::kMaxFrequency) continue;
+                        float phases[6];
+                        for (float &p : phases) {
+                            p = phase(rng);
+                        }
+                        for (int i = 0; i < size; ++i) {
+                            float t = i / kSampleRate;
+                            float sample = 0.0f;
+                            for (int h = 1; h <= 6; ++h) {
+                                sample += sinf(2.0f * pi * h * frequency * t + phases[h - 1]) / h;
+                            }
+                            signal[i] = level * (0.5f * sample + noise(rng));
+                        }
+
+                        float expected = floatDetector->Process(signal.data(), size).frequency;
+                        float frequency16 = fixedDetector->Process(signal.data(), size).frequency;
+                        // Out of reach for the window in float too
+                        if (expected <= 0.0f) continue;
+
+                        ++readings;
+                        double cents = frequency16 > 0.0f ? fabs(1200.0 * log2(frequency16 / expected)) : 1e9;
+                        if (cents > 50.0) {
+                            ++mismatches;
+                            continue;
+                        }
+                        worst = std::max(worst, cents);
+                        total += cents;
+                    }
+                }
+            }
+
+            printf("%-16s %7d %8d %12.4f %12.4f %10d\n", Tuner::GetDetectorInfo(type).name, size, readings,
+                worst, readings > mismatches ? total / (readings - mismatches) : 0.0, mismatches);
+            if (worst > Tuner::kFixedPointCentsBound || mismatches > 0) {
+                ++failures;
+            }
+        }
+    }
+
+    printf("bound %.2f cents: %s\n", Tuner::kFixedPointCentsBound, failures == 0 ? "ok" : "exceeded");
+    return failures == 0 ? 0 : 1;
+}
+
+// Readings the analysis pipeline publishes for 3 s of audio at hops below
+// and above the block size, fed in large blocks inline and on a detect
+// thread, and in hop sized calls through Analyzer. Every window has to
+// come out, (samples - window) / hop + 1 of them. Returns non-zero when
+// one is missing.
+int RunPipelineReport() {
+    const int kSamples = 3 * (int)kSampleRate;
+    const int kFeedBlock = 4096;
+    std::vector<float> signal = MakeSignal(kSamples, 82.41f);
+
+    int failures = 0;
+    printf("\n%-10s %8s %8s %8s %10s\n", "pipeline", "hop", "expected", "inline", "threaded");
+    for (int hop : {128, 256, 512, 2048}) {
+        Tuner::AnalyzerConfig config;
+        config.sampleRate = kSampleRate;
+        config.hopSize = hop;
+        long long expected = (kSamples - config.windowSize) / hop + 1;
+
+        long long counts[2] = {};
+        for (int threaded = 0; threaded < 2; ++threaded) {
+            Tuner::Pipeline pipeline;
+            long long &count = counts[threaded];
+            Tuner::AddAnalysisStages(pipeline, config, threaded ? Tuner::StageRun::Thread : Tuner::StageRun::Inline,
+                [&count](const Tuner::Reading &) { ++count; });
+            Tuner::PipelineFormat format;
+            format.sampleRate = kSampleRate;
+            format.maxBlock = Tuner::kAnalysisBlock;
+            pipeline.Prepare(format);
+            for (int offset = 0; offset < kSamples; offset += kFeedBlock) {
+                pipeline.PushWaiting(signal.data() + offset, std::min(kFeedBlock, kSamples - offset));
+            }
+            pipeline.Flush();
+        }
+
+        Tuner::Analyzer analyzer;
+        analyzer.Prepare(config);
+        long long analyzed = 0;
+        for (int offset = 0; offset < kSamples; offset += hop) {
+            Tuner::AnalyzerResult result;
+            analyzed += analyzer.Process(signal.data() + offset, std::min(hop, kSamples - offset), result) ? 1 : 0;
+        }
+
+        printf("%-10s %8d %8lld %8lld %10lld\n", "analysis", hop, expected, counts[0], counts[1]);
+        if (counts[0] != expected || counts[1] != expected || analyzed != expected) {
+            ++failures;
+        }
+    }
+
+    printf("every window: %s\n", failures == 0 ? "ok" : "missing readings");
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : "";
+    if (strcmp(filter, "--accuracy") == 0) {
+        int status = RunAccuracyReport();
+        status |= RunFixedPointReport();
+        return RunPipelineReport() != 0 ? 1 : status;
+    }
+
+    std::vector<float> window = MakeSignal(kWindowSize, 82.41f);
+    std::vector<float> block(kBlockSize);
+    std::vector<Benchmark> benchmarks;
+    // Test signals for the other window sizes, a deque so references stay valid
+    std::deque<std::vector<float>> signals;
+
+    // Pre-filter stage, default config and with the high-pass added
+    Tuner::PreFilter preFilter;
+    preFilter.Prepare(kSampleRate);
+    Tuner::PreFilter preFilterHighPass;
+    Tuner::PreFilterConfig highPassConfig;
+    highPassConfig.highPass = true;
+    preFilterHighPass.SetConfig(highPassConfig);
+    preFilterHighPass.Prepare(kSampleRate);
+
+    benchmarks.push_back({"prefilter/default", kBlockSize, [&]() {
+        memcpy(block.data(), window.data(), kBlockSize * sizeof(float));
+        preFilter.Process(block.data(), kBlockSize);
+    }});
+    benchmarks.push_back({"prefilter/highpass", kBlockSize, [&]() {
+        memcpy(block.data(), window.data(), kBlockSize * sizeof(float));
+        preFilterHighPass.Process(block.data(), kBlockSize);
+    }});
+
+    Tuner::NoiseGate noiseGate;
+    noiseGate.Prepare(kSampleRate, kBlockSize);
+    benchmarks.push_back({"gate/block", kBlockSize, [&]() {
+        noiseGate.Process(window.data(), kBlockSize);
+    }});
+
+    Tuner::Strobe strobe;
+    strobe.Prepare(kSampleRate);
+    strobe.SetReference(82.41f);
+    benchmarks.push_back({"strobe/block", kBlockSize, [&]() {
+        strobe.Process(window.data(), kBlockSize);
+    }});
+
+    std::vector<std::unique_ptr<Tuner::PitchDetector>> detectors;
+    for (const auto& info : Tuner::GetDetectorRegistry()) {
+        detectors.push_back(info.create());
+        Tuner::PitchDetector *detector = detectors.back().get();
+        detector->Prepare(kSampleRate, kWindowSize);
+
+        benchmarks.push_back({std::string("detector/") + info.name, kWindowSize, [&window, detector]() {
+            detector->Process(window.data(), kWindowSize);
+        }});
+    }
+
+    // The correlation detectors again on the int16 kernels
+    for (Tuner::DetectorType type : {Tuner::DetectorType::Autocorrelation, Tuner::DetectorType::Nsdf}) {
+        detectors.push_back(Tuner::CreateDetector(type));
+        Tuner::PitchDetector *detector = detectors.back().get();
+        detector->Prepare(kSampleRate, kWindowSize);
+        detector->SetAccumulation(Tuner::Accumulation::FixedPoint);
+
+        benchmarks.push_back({std::string("detector/") + Tuner::GetDetectorInfo(type).name + "/int16", kWindowSize,
+            [&window, detector]() {
+                detector->Process(window.data(), kWindowSize);
+            }});
+    }
+
+    // Integer stages ahead of the int16 correlation
+    std::vector<int16_t> quantized(kWindowSize);
+    std::vector<int16_t> decimated(kWindowSize / 2);
+    benchmarks.push_back({"int16/quantize", kWindowSize, [&window, &quantized]() {
+        Tuner::Quantize(window.data(), kWindowSize, quantized.data());
+    }});
+    benchmarks.push_back({"int16/decimate", kWindowSize, [&quantized, &decimated]() {
+        Tuner::DecimateFixed(quantized.data(), kWindowSize, decimated.data());
+    }});
+
+    // Correlation over the NSDF's lag range for every window size: the old
+    // scalar loop against the tiled kernel in every accumulation mode
+    std::vector<float> correlation(kMaxWindowSize / 2 + 1);
+    std::vector<int16_t> scratch(kMaxWindowSize);
+    for (int size = 512; size <= kMaxWindowSize; size *= 2) {
+        std::vector<float> &signal = signals.emplace_back(MakeSignal(size, 82.41f));
+        int endLag = std::min(size / 2, (int)ceilf(kSampleRate / Tuner::kMinFrequency)) + 1;
+        std::string prefix = "correlation/" + std::to_string(size);
+
+        benchmarks.push_back({prefix + "/scalar", size, [&signal, &correlation, size, endLag]() {
+            CorrelateScalar(signal.data(), size, 0, endLag, correlation.data());
+        }});
+        for (const auto& info : Tuner::GetAccumulationModes()) {
+            Tuner::Accumulation accumulation = info.accumulation;
+            benchmarks.push_back({prefix + "/" + GetModeName(info), size,
+                [&signal, &correlation, &scratch, size, endLag, accumulation]() {
+                    Tuner::Correlate(signal.data(), size, 0, endLag, correlation.data(), accumulation,
+                        scratch.data());
+                }});
+        }
+    }
+
+    // Frame energy for RMS on the longest window
+    std::vector<float> &longest = signals.back();
+    for (const auto& info : Tuner::GetAccumulationModes()) {
+        Tuner::Accumulation accumulation = info.accumulation;
+        benchmarks.push_back({"energy/" + std::to_string(kMaxWindowSize) + "/" + GetModeName(info), kMaxWindowSize,
+            [&longest, accumulation]() {
+                volatile float sum = Tuner::SumSquares(longest.data(), kMaxWindowSize, accumulation);
+                (void)sum;
+            }});
+    }
+
+    printf("%-32s %14s %12s\n", "benchmark", "time/call", "real-time");
+    for (const auto& benchmark : benchmarks) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+
+        double seconds = Measure(benchmark);
+        double budget = benchmark.samples / kSampleRate;
+        printf("%-32s %11.2f us %11.3f%%\n", benchmark.name.c_str(), seconds * 1e6, 100.0 * seconds / budget);
+    }
+
+    return 0;
+}
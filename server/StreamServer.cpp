@@ -0,0 +1,277 @@
+#include "StreamServer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+
+// Latency histogram
+
+void LatencyHistogram::Add(double ms) {
+    int bin = ms > kMinMs ? (int)(log10(ms / kMinMs) * kBinsPerDecade) : 0;
+    ++mBins[std::min(bin, (int)mBins.size() - 1)];
+    ++mCount;
+    mMax = std::max(mMax, ms);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < mBins.size(); ++i) {
+        mBins[i] += other.mBins[i];
+    }
+    mCount += other.mCount;
+    mMax = std::max(mMax, other.mMax);
+}
+
+double LatencyHistogram::GetPercentile(double fraction) const {
+    if (mCount == 0) return 0.0;
+
+    long long index = std::min(mCount - 1, (long long)(fraction * mCount));
+    long long seen = 0;
+    for (size_t i = 0; i < mBins.size(); ++i) {
+        seen += mBins[i];
+        if (seen > index) {
+            return std::min(mMax, kMinMs * pow(10.0, (i + 1) / (double)kBinsPerDecade));
+        }
+    }
+    return mMax;
+}
+
+// Server
+
+void StreamServer::Totals::Add(const Stream &stream) {
+    ++streams;
+    latencies.Merge(stream.latencies);
+    analyses += stream.analyses;
+    misses += stream.misses;
+    samples += stream.samples;
+    dropped += stream.dropped;
+}
+
+StreamServer::StreamServer(const ServerOptions &options)
+    : mOptions(options), mPool(options.threads) {
+    mReadBuffer.resize(options.analyzer.hopSize);
+    mBudget = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(options.deadlineMs));
+}
+
+StreamServer::~StreamServer() {
+    mPool.WaitIdle();
+}
+
+void StreamServer::AddStream(std::unique_ptr<StreamSource> source) {
+    auto stream = std::make_unique<Stream>();
+    stream->id = mNextId++;
+    stream->source = std::move(source);
+    stream->analyzer.Prepare(mOptions.analyzer);
+
+    int capacity = mOptions.analyzer.hopSize * mOptions.maxBacklogHops;
+    stream->inbox.resize(capacity);
+    stream->job.resize(capacity);
+    stream->inboxReady.resize(mOptions.maxBacklogHops);
+    stream->jobReady.resize(mOptions.maxBacklogHops);
+
+    mStreams.push_back(std::move(stream));
+}
+
+void StreamServer::SetListener(SocketListener *listener) {
+    mListener = listener;
+}
+
+void StreamServer::Run(double seconds) {
+    Clock::time_point start = Clock::now();
+
+    while (true) {
+        mElapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds > 0.0 && mElapsed >= seconds) break;
+
+        bool anyOpen = mListener != nullptr;
+        for (auto& stream : mStreams) {
+            if (!stream->ended) {
+                ReadStream(*stream);
+                anyOpen |= !stream->ended;
+            }
+            Schedule(*stream);
+        }
+        RemoveEnded();
+        if (seconds <= 0.0 && !anyOpen) break;
+
+        Poll(1);
+    }
+
+    mPool.WaitIdle();
+    // Flush what was left in the inboxes of ended streams
+    for (auto& stream : mStreams) {
+        Schedule(*stream);
+    }
+    mPool.WaitIdle();
+    mElapsed = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void StreamServer::Poll(int timeoutMs) {
+    std::vector<pollfd> fds;
+    if (mListener) {
+        fds.push_back({mListener->GetFd(), POLLIN, 0});
+    }
+    for (const auto& stream : mStreams) {
+        int fd = stream->source->GetFd();
+        if (fd >= 0 && !stream->ended) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+    }
+
+    // With only clock driven sources there's nothing to wait on, the loop
+    // still has to turn over to pick up their samples
+    if (fds.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+    poll(fds.data(), fds.size(), timeoutMs);
+
+    if (mListener && (fds[0].revents & POLLIN)) {
+        int fd;
+        while ((fd = mListener->Accept()) >= 0) {
+            std::string name = "socket:" + std::to_string(mNextId);
+            AddStream(std::make_unique<FdSource>(fd, name, true));
+            fprintf(stderr, "darktuna_server: %s connected\n", name.c_str());
+        }
+    }
+}
+
+void StreamServer::ReadStream(Stream &stream) {
+    int capacity = (int)stream.inbox.size();
+    int hopSize = mOptions.analyzer.hopSize;
+    bool realtime = stream.source->IsRealtime();
+
+    while (true) {
+        // Offline sources wait for room instead of losing audio
+        int request = (int)mReadBuffer.size();
+        if (!realtime) {
+            request = std::min(request, capacity - stream.inboxCount);
+            if (request == 0) return;
+        }
+
+        int got = stream.source->Read(mReadBuffer.data(), request);
+        if (got < 0) {
+            stream.ended = true;
+            return;
+        }
+        if (got == 0) return;
+
+        // Falling behind a live input: keep the newest audio, it's the one that matters
+        int room = capacity - stream.inboxCount;
+        if (got > room) {
+            int drop = std::min(got - room, stream.inboxCount);
+            memmove(stream.inbox.data(), stream.inbox.data() + drop, (stream.inboxCount - drop) * sizeof(float));
+            // Each hop left takes the time of the one its last sample was in
+            for (int hop = 0; (hop + 1) * hopSize + drop <= stream.inboxCount; ++hop) {
+                stream.inboxReady[hop] = stream.inboxReady[((hop + 1) * hopSize - 1 + drop) / hopSize];
+            }
+            stream.inboxCount -= drop;
+            stream.dropped += drop;
+            room += drop;
+        }
+
+        int take = std::min(got, room);
+        memcpy(stream.inbox.data() + stream.inboxCount, mReadBuffer.data(), take * sizeof(float));
+        // The hops this read completed or added to end with it
+        Clock::time_point now = Clock::now();
+        for (int hop = stream.inboxCount / hopSize; hop * hopSize < stream.inboxCount + take; ++hop) {
+            stream.inboxReady[hop] = now;
+        }
+        stream.inboxCount += take;
+        stream.dropped += got - take;
+
+        if (got < request) return;
+    }
+}
+
+void StreamServer::Schedule(Stream &stream) {
+    if (stream.busy.load(std::memory_order_acquire)) return;
+
+    bool enough = stream.inboxCount >= mOptions.analyzer.hopSize;
+    if (!enough && !(stream.ended && stream.inboxCount > 0)) return;
+
+    std::swap(stream.inbox, stream.job);
+    std::swap(stream.inboxReady, stream.jobReady);
+    stream.jobCount = stream.inboxCount;
+    stream.inboxCount = 0;
+    stream.deadline = stream.jobReady[0] + mBudget;
+    stream.busy.store(true, std::memory_order_release);
+
+    Stream *target = &stream;
+    mPool.Submit([this, target]() { RunJob(*target); }, stream.deadline, stream.id);
+}
+
+void StreamServer::RunJob(Stream &stream) {
+    int hopSize = mOptions.analyzer.hopSize;
+
+    // A backlog holds several hops, feed them one at a time so none of
+    // their results are lost
+    for (int offset = 0; offset < stream.jobCount; offset += hopSize) {
+        int count = std::min(hopSize, stream.jobCount - offset);
+        Tuner::AnalyzerResult result;
+        bool analyzed = stream.analyzer.Process(stream.job.data() + offset, count, result);
+        stream.samples += count;
+        if (!analyzed) continue;
+
+        Clock::time_point done = Clock::now();
+        Clock::time_point ready = stream.jobReady[offset / hopSize];
+        ++stream.analyses;
+        stream.latencies.Add(std::chrono::duration<double, std::milli>(done - ready).count());
+        if (done > ready + mBudget) {
+            ++stream.misses;
+        }
+
+        if (result.note && (mOptions.printResults || stream.source->GetFd() >= 0)) {
+            char line[128];
+            int length = snprintf(line, sizeof(line), "%lld %s %.2f %+.2f\n",
+                result.sampleIndex, result.note->name.c_str(), result.frequency, result.centsOff);
+            stream.source->Reply(line, length);
+            if (mOptions.printResults) {
+                printf("%s %s", stream.source->GetName().c_str(), line);
+            }
+        }
+    }
+
+    stream.busy.store(false, std::memory_order_release);
+}
+
+void StreamServer::RemoveEnded() {
+    auto done = [this](const std::unique_ptr<Stream> &stream) {
+        if (!stream->ended || stream->inboxCount > 0 || stream->busy.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (stream->source->GetFd() >= 0) {
+            fprintf(stderr, "darktuna_server: %s disconnected\n", stream->source->GetName().c_str());
+        }
+        mRetired.Add(*stream);
+        return true;
+    };
+    mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(), done), mStreams.end());
+}
+
+ServerReport StreamServer::GetReport() const {
+    Totals totals = mRetired;
+    for (const auto& stream : mStreams) {
+        totals.Add(*stream);
+    }
+
+    ServerReport report;
+    report.streams = totals.streams;
+    report.seconds = mElapsed;
+    report.steals = mPool.GetStealCount();
+    report.analyses = totals.analyses;
+    report.deadlineMisses = totals.misses;
+    report.droppedSamples = totals.dropped;
+    if (mElapsed > 0.0) {
+        report.realtimeFactor = totals.samples / (double)mOptions.analyzer.sampleRate / mElapsed;
+    }
+    report.p50 = totals.latencies.GetPercentile(0.5);
+    report.p99 = totals.latencies.GetPercentile(0.99);
+    report.p999 = totals.latencies.GetPercentile(0.999);
+    report.max = totals.latencies.GetMax();
+    return report;
+}
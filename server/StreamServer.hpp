@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "Analyzer.hpp"
+#include "StreamSource.hpp"
+#include "ThreadPool.hpp"
+
+struct ServerOptions {
+    int threads = 1;
+    // Budget from a hop of audio being complete to its result
+    double deadlineMs = 20.0;
+    // Audio a stream may queue while its previous job runs, in hops
+    int maxBacklogHops = 8;
+    bool printResults = false;
+    Tuner::AnalyzerConfig analyzer;
+};
+
+struct ServerReport {
+    int streams = 0;
+    double seconds = 0.0;
+    long long analyses = 0;
+    long long deadlineMisses = 0;
+    long long droppedSamples = 0;
+    // Seconds of audio analyzed per second of wall time
+    double realtimeFactor = 0.0;
+    unsigned long long steals = 0;
+    // Latency from a hop being complete to its result, in milliseconds
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+// Latencies counted in log spaced bins, under 4% wide, from 1 us to 10 s.
+// Stays the same size however long the server runs, and the histograms of
+// several streams add up.
+class LatencyHistogram {
+public:
+    void Add(double ms);
+    void Merge(const LatencyHistogram &other);
+
+    // Upper edge of the bin fraction of the latencies fall in, at most the
+    // largest one. 0 when empty.
+    double GetPercentile(double fraction) const;
+
+    inline long long GetCount() const {
+        return mCount;
+    }
+
+    inline double GetMax() const {
+        return mMax;
+    }
+
+private:
+    static constexpr int kBinsPerDecade = 64;
+    static constexpr int kDecades = 7;
+    static constexpr double kMinMs = 0.001;
+
+    std::array<long long, kBinsPerDecade * kDecades> mBins = {};
+    long long mCount = 0;
+    double mMax = 0.0;
+};
+
+// Runs one Analyzer per stream on a shared pool. A single I/O loop drains
+// every source without blocking, and whenever a stream has a hop of audio
+// and no job in flight, it hands that audio to the pool. Each hop is due
+// deadlineMs after its last sample was read, so time spent waiting in the
+// inbox counts, and the job's deadline is its oldest hop's. Streams never
+// run concurrently with themselves, so the
+// per-stream state needs no locking. Streams that ended are dropped once
+// their last job is done, which closes their sockets.
+class StreamServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StreamServer(const ServerOptions &options);
+    ~StreamServer();
+
+    void AddStream(std::unique_ptr<StreamSource> source);
+    // Connections on this socket become streams while Run is going
+    void SetListener(SocketListener *listener);
+
+    // Runs until the time is up, or until every source ended if seconds is 0
+    void Run(double seconds);
+
+    ServerReport GetReport() const;
+
+private:
+    struct Stream {
+        int id = 0;
+        std::unique_ptr<StreamSource> source;
+        Tuner::Analyzer analyzer;
+        bool ended = false;
+
+        // Filled by the I/O loop, swapped with the job buffer on submit
+        std::vector<float> inbox;
+        int inboxCount = 0;
+        std::vector<float> job;
+        int jobCount = 0;
+        // When the last sample of each hop in the inbox and the job was
+        // read, a partial hop's counts as one
+        std::vector<Clock::time_point> inboxReady;
+        std::vector<Clock::time_point> jobReady;
+        Clock::time_point deadline;
+        std::atomic<bool> busy{false};
+        long long dropped = 0;
+
+        // Only touched by the job in flight
+        LatencyHistogram latencies;
+        long long analyses = 0;
+        long long misses = 0;
+        long long samples = 0;
+    };
+
+    // What the streams that are gone added to the report
+    struct Totals {
+        int streams = 0;
+        LatencyHistogram latencies;
+        long long analyses = 0;
+        long long misses = 0;
+        long long samples = 0;
+        long long dropped = 0;
+
+        void Add(const Stream &stream);
+    };
+
+    ServerOptions mOptions;
+    // deadlineMs on the clock
+    Clock::duration mBudget;
+    ThreadPool mPool;
+    std::vector<std::unique_ptr<Stream>> mStreams;
+    Totals mRetired;
+    int mNextId = 0;
+    SocketListener *mListener = nullptr;
+    std::vector<float> mReadBuffer;
+    double mElapsed = 0.0;
+
+    void Poll(int timeoutMs);
+    void ReadStream(Stream &stream);
+    void Schedule(Stream &stream);
+    void RunJob(Stream &stream);
+    // Drops streams that ended and have nothing left to analyze
+    void RemoveEnded();
+};
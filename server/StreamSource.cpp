@@ -0,0 +1,198 @@
+#include "StreamSource.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+int SamplesDue(std::chrono::steady_clock::time_point start, float sampleRate, long long delivered) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long due = (long long)(elapsed * sampleRate) - delivered;
+    return (int)std::max(0LL, std::min(due, 1LL << 20));
+}
+
+} // namespace
+
+// FdSource
+
+FdSource::FdSource(int fd, std::string name, bool canReply)
+    : mFd(fd), mName(std::move(name)), mCanReply(canReply) {
+    fcntl(mFd, F_SETFL, fcntl(mFd, F_GETFL) | O_NONBLOCK);
+}
+
+FdSource::~FdSource() {
+    close(mFd);
+}
+
+int FdSource::Read(float *buffer, int maxSamples) {
+    size_t wanted = (size_t)maxSamples * sizeof(float) - mPartialCount;
+    if (mBytes.size() < wanted) {
+        mBytes.resize(wanted);
+    }
+
+    ssize_t got = read(mFd, mBytes.data(), wanted);
+    if (got == 0) return -1;
+    if (got < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    // Stitch a sample split over two reads back together
+    int count = 0;
+    size_t offset = 0;
+    if (mPartialCount > 0) {
+        size_t need = sizeof(float) - mPartialCount;
+        size_t take = std::min(need, (size_t)got);
+        memcpy(mPartial + mPartialCount, mBytes.data(), take);
+        mPartialCount += (int)take;
+        offset = take;
+        if (mPartialCount == (int)sizeof(float)) {
+            memcpy(&buffer[count++], mPartial, sizeof(float));
+            mPartialCount = 0;
+        }
+    }
+
+    size_t whole = ((size_t)got - offset) / sizeof(float);
+    memcpy(buffer + count, mBytes.data() + offset, whole * sizeof(float));
+    count += (int)whole;
+    offset += whole * sizeof(float);
+
+    size_t rest = (size_t)got - offset;
+    memcpy(mPartial + mPartialCount, mBytes.data() + offset, rest);
+    mPartialCount += (int)rest;
+    return count;
+}
+
+void FdSource::Reply(const char *line, int length) {
+    if (!mCanReply) return;
+    // Results are best effort, a slow client just misses some
+    send(mFd, line, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// FileSource
+
+FileSource::FileSource(FILE *file, std::string name, float sampleRate)
+    : mFile(file), mName(std::move(name)), mSampleRate(sampleRate),
+      mStart(std::chrono::steady_clock::now()) {}
+
+FileSource::~FileSource() {
+    fclose(mFile);
+}
+
+int FileSource::Read(float *buffer, int maxSamples) {
+    int due = std::min(maxSamples, SamplesDue(mStart, mSampleRate, mDelivered));
+    if (due == 0) return 0;
+
+    size_t got = fread(buffer, sizeof(float), due, mFile);
+    if (got == 0 && feof(mFile)) return -1;
+
+    mDelivered += (long long)got;
+    return (int)got;
+}
+
+// SignalBank
+
+SignalBank::SignalBank(float sampleRate, int numSignals, float seconds) {
+    const float pi = 3.14159265f;
+    // Open strings of a guitar in standard tuning
+    const float strings[] = { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f };
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> detune(-30.0f, 30.0f);
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+
+    int size = (int)(sampleRate * seconds);
+    for (int s = 0; s < numSignals; ++s) {
+        float freq = strings[s % 6] * powf(2.0f, detune(rng) / 1200.0f);
+
+        std::vector<float> signal(size);
+        for (int i = 0; i < size; ++i) {
+            float t = i / sampleRate;
+            signal[i] = 0.10f * sinf(2.0f * pi * freq * t)
+                + 0.05f * sinf(2.0f * pi * 2.0f * freq * t + 0.3f)
+                + 0.03f * sinf(2.0f * pi * 3.0f * freq * t + 0.7f)
+                + noise(rng);
+        }
+        mSignals.push_back(std::move(signal));
+    }
+}
+
+// SyntheticSource
+
+SyntheticSource::SyntheticSource(const SignalBank &bank, int index, float sampleRate, bool paced)
+    : mSignal(bank.GetSignal(index % bank.GetNumSignals())), mIndex(index),
+      mSampleRate(sampleRate), mPaced(paced), mStart(std::chrono::steady_clock::now()) {
+    // Spread the streams over the loop so they don't all wrap at once
+    mPosition = ((size_t)index * 7919) % mSignal.size();
+}
+
+int SyntheticSource::Read(float *buffer, int maxSamples) {
+    int count = mPaced ? std::min(maxSamples, SamplesDue(mStart, mSampleRate, mDelivered)) : maxSamples;
+
+    int done = 0;
+    while (done < count) {
+        int chunk = std::min(count - done, (int)(mSignal.size() - mPosition));
+        memcpy(buffer + done, mSignal.data() + mPosition, chunk * sizeof(float));
+        done += chunk;
+        mPosition = (mPosition + chunk) % mSignal.size();
+    }
+
+    mDelivered += count;
+    return count;
+}
+
+// SocketListener
+
+SocketListener::~SocketListener() {
+    if (mFd >= 0) {
+        close(mFd);
+        unlink(mPath.c_str());
+    }
+}
+
+bool SocketListener::Open(const std::string &path) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) return false;
+
+    mFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mFd < 0) return false;
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path.c_str());
+
+    if (bind(mFd, (sockaddr *)&address, sizeof(address)) < 0 || listen(mFd, 64) < 0) {
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    fcntl(mFd, F_SETFL, fcntl(mFd, F_GETFL) | O_NONBLOCK);
+    mPath = path;
+    return true;
+}
+
+int SocketListener::Accept() {
+    if (mFd < 0) return -1;
+    return accept(mFd, nullptr, nullptr);
+}
+
+int OpenFifo(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        if (mkfifo(path.c_str(), 0666) != 0) return -1;
+    } else if (!S_ISFIFO(info.st_mode)) {
+        return -1;
+    }
+
+    // Read-write keeps the pipe open across writers coming and going
+    return open(path.c_str(), O_RDWR | O_NONBLOCK);
+}
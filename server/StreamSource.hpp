@@ -0,0 +1,153 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where a stream's audio comes from. Every source delivers mono float32
+// samples at the server's sample rate and is read without blocking from the
+// server's I/O loop.
+class StreamSource {
+public:
+    virtual ~StreamSource() = default;
+
+    // Reads up to maxSamples, returns how many were read or -1 once the
+    // source has ended for good
+    virtual int Read(float *buffer, int maxSamples) = 0;
+
+    // Descriptor to poll for readability, -1 for clock driven sources
+    virtual int GetFd() const {
+        return -1;
+    }
+
+    // Sends a result line back where the transport has a way back
+    virtual void Reply(const char *, int) {}
+
+    // Live sources keep producing whether or not they are read, so the
+    // server drops their oldest audio when it falls behind. Others are
+    // only read when there is room.
+    virtual bool IsRealtime() const {
+        return true;
+    }
+
+    virtual std::string GetName() const = 0;
+};
+
+// A connected UNIX socket or an open named pipe carrying raw float32
+class FdSource : public StreamSource {
+public:
+    FdSource(int fd, std::string name, bool canReply);
+    ~FdSource() override;
+
+    int Read(float *buffer, int maxSamples) override;
+    void Reply(const char *line, int length) override;
+
+    int GetFd() const override {
+        return mFd;
+    }
+
+    // Unread audio waits in the kernel and pushes back on the writer
+    bool IsRealtime() const override {
+        return false;
+    }
+
+    std::string GetName() const override {
+        return mName;
+    }
+
+private:
+    int mFd;
+    std::string mName;
+    bool mCanReply;
+    // A read can end in the middle of a sample
+    unsigned char mPartial[sizeof(float)];
+    int mPartialCount = 0;
+    std::vector<unsigned char> mBytes;
+};
+
+// Raw float32 file replayed at real-time pace, a stand-in for a live input
+class FileSource : public StreamSource {
+public:
+    FileSource(FILE *file, std::string name, float sampleRate);
+    ~FileSource() override;
+
+    int Read(float *buffer, int maxSamples) override;
+
+    std::string GetName() const override {
+        return mName;
+    }
+
+private:
+    FILE *mFile;
+    std::string mName;
+    float mSampleRate;
+    std::chrono::steady_clock::time_point mStart;
+    long long mDelivered = 0;
+};
+
+// Shared bank of detuned guitar notes that synthetic streams loop over, so
+// hundreds of them cost a memcpy each rather than hundreds of oscillators
+class SignalBank {
+public:
+    SignalBank(float sampleRate, int numSignals, float seconds);
+
+    inline int GetNumSignals() const {
+        return (int)mSignals.size();
+    }
+
+    inline const std::vector<float>& GetSignal(int index) const {
+        return mSignals[index];
+    }
+
+private:
+    std::vector<std::vector<float>> mSignals;
+};
+
+// Synthetic stream for the load harness. Paced streams produce samples as
+// the clock advances like a real input, unpaced ones as fast as they are read.
+class SyntheticSource : public StreamSource {
+public:
+    SyntheticSource(const SignalBank &bank, int index, float sampleRate, bool paced);
+
+    int Read(float *buffer, int maxSamples) override;
+
+    bool IsRealtime() const override {
+        return mPaced;
+    }
+
+    std::string GetName() const override {
+        return "synthetic:" + std::to_string(mIndex);
+    }
+
+private:
+    const std::vector<float> &mSignal;
+    int mIndex;
+    float mSampleRate;
+    bool mPaced;
+    size_t mPosition;
+    std::chrono::steady_clock::time_point mStart;
+    long long mDelivered = 0;
+};
+
+// Listening UNIX socket, every accepted connection becomes a stream
+class SocketListener {
+public:
+    ~SocketListener();
+
+    bool Open(const std::string &path);
+    // Returns a connected descriptor, or -1 when nobody is waiting
+    int Accept();
+
+    inline int GetFd() const {
+        return mFd;
+    }
+
+private:
+    int mFd = -1;
+    std::string mPath;
+};
+
+// Opens a named pipe for reading, creating it first if needed
+int OpenFifo(const std::string &path);
@@ -0,0 +1,107 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) {
+    numThreads = std::max(1, numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        mQueues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(Job job, Clock::time_point deadline, int home) {
+    Queue &queue = *mQueues[home % mQueues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back({deadline, std::move(job)});
+        std::push_heap(queue.tasks.begin(), queue.tasks.end(), LaterDeadline());
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        ++mQueued;
+    }
+    mWake.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+    mIdle.wait(lock, [this]() { return mQueued == 0 && mRunning == 0; });
+}
+
+bool ThreadPool::TryPop(int index, Task &task) {
+    Queue &queue = *mQueues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+
+    std::pop_heap(queue.tasks.begin(), queue.tasks.end(), LaterDeadline());
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+int ThreadPool::FindEarliest(int index) {
+    int numQueues = (int)mQueues.size();
+    int earliest = -1;
+    Clock::time_point deadline = Clock::time_point::max();
+    for (int i = 1; i < numQueues; ++i) {
+        int victim = (index + i) % numQueues;
+        Queue &queue = *mQueues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty() && queue.tasks.front().deadline < deadline) {
+            deadline = queue.tasks.front().deadline;
+            earliest = victim;
+        }
+    }
+    return earliest;
+}
+
+void ThreadPool::WorkerLoop(int index) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mWake.wait(lock, [this]() { return mStop || mQueued > 0; });
+            if (mStop) return;
+            // Claim a job now so two workers never chase the same one
+            --mQueued;
+            ++mRunning;
+        }
+
+        // Own queue first, then the earliest deadline of all the others. A
+        // job claimed above is somewhere, another thief may just get to the
+        // one picked first.
+        Task task;
+        bool found = TryPop(index, task);
+        while (!found) {
+            int victim = FindEarliest(index);
+            found = victim >= 0 && TryPop(victim, task);
+            if (found) {
+                mSteals.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        task.job();
+
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            --mRunning;
+            if (mQueued == 0 && mRunning == 0) {
+                mIdle.notify_all();
+            }
+        }
+    }
+}
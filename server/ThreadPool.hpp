@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers with one deadline-ordered queue each. A worker runs
+// the earliest deadline in its own queue first and, when that is empty,
+// steals the earliest deadline across all the other queues, so a burst of
+// jobs on one queue spreads over every core.
+class ThreadPool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Job = std::function<void()>;
+
+    explicit ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // home picks the queue, keeping one stream on one worker keeps its
+    // analyzer state warm in that core's cache
+    void Submit(Job job, Clock::time_point deadline, int home);
+    // Blocks until every submitted job has finished
+    void WaitIdle();
+
+    inline int GetNumThreads() const {
+        return (int)mThreads.size();
+    }
+
+    inline unsigned long long GetStealCount() const {
+        return mSteals.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Task {
+        Clock::time_point deadline;
+        Job job;
+    };
+
+    // Heap order with the earliest deadline on top
+    struct LaterDeadline {
+        bool operator()(const Task &a, const Task &b) const {
+            return a.deadline > b.deadline;
+        }
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        // Min-heap on deadline
+        std::vector<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    std::condition_variable mIdle;
+    int mQueued = 0;
+    int mRunning = 0;
+    bool mStop = false;
+
+    std::atomic<unsigned long long> mSteals{0};
+
+    bool TryPop(int index, Task &task);
+    // Queue other than index with the earliest deadline on top, -1 when
+    // they are all empty
+    int FindEarliest(int index);
+    void WorkerLoop(int index);
+};
@@ -0,0 +1,211 @@
+// Tuning server for many concurrent streams. Every stream is mono float32 at
+// the server's sample rate and gets its own analyzer state. Socket clients
+// get a "sampleIndex note frequency cents" line back per result.
+//
+//   darktuna_server --listen /tmp/darktuna.sock
+//   darktuna_server --fifo /tmp/station1 --fifo /tmp/station2 --print
+//   darktuna_server --file recording.f32 --print
+//
+// With --simulate the server instead measures itself on synthetic streams,
+// once for every thread count given:
+//
+//   darktuna_server --simulate 300 --threads 1,2,4,8 --duration 10
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StreamServer.hpp"
+
+namespace {
+
+struct Arguments {
+    // One socket, the server takes connections from a single listener
+    std::string listen;
+    std::vector<std::string> fifos;
+    std::vector<std::string> files;
+    int simulate = 0;
+    std::vector<int> threads;
+    double duration = 0.0;
+    bool paced = true;
+    ServerOptions options;
+};
+
+void PrintUsage() {
+    fprintf(stderr,
+        "usage: darktuna_server [options]\n"
+        "  --listen PATH      accept streams on a UNIX socket\n"
+        "  --fifo PATH        read a stream from a named pipe, repeatable\n"
+        "  --file PATH        replay a raw float32 file in real time, repeatable\n"
+        "  --simulate N       load test with N synthetic streams\n"
+        "  --threads N[,M..]  worker threads, a list runs the load test once per count\n"
+        "  --duration S       stop after S seconds (default: when the inputs end)\n"
+        "  --deadline MS      latency budget per analysis (default 20)\n"
+        "  --detector NAME    pitch detector (default Auto)\n"
+        "  --accumulation M   Float, Mixed, Pairwise, Kahan, Double or Int16 (default Float)\n"
+        "  --sample-rate HZ   sample rate of every stream (default 44100)\n"
+        "  --unpaced          feed synthetic streams as fast as they are analyzed\n"
+        "  --print            print every result to stdout\n");
+}
+
+std::vector<int> ParseList(const char *text) {
+    std::vector<int> values;
+    for (const char *p = text; *p;) {
+        values.push_back(atoi(p));
+        const char *comma = strchr(p, ',');
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return values;
+}
+
+bool ParseArguments(int argc, char **argv, Arguments &args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--unpaced") {
+            args.paced = false;
+        } else if (arg == "--print") {
+            args.options.printResults = true;
+        } else if (!hasValue) {
+            return false;
+        } else if (arg == "--listen") {
+            if (!args.listen.empty()) {
+                fprintf(stderr, "darktuna_server: only one --listen socket is supported\n");
+                return false;
+            }
+            args.listen = argv[++i];
+        } else if (arg == "--fifo") {
+            args.fifos.push_back(argv[++i]);
+        } else if (arg == "--file") {
+            args.files.push_back(argv[++i]);
+        } else if (arg == "--simulate") {
+            args.simulate = atoi(argv[++i]);
+        } else if (arg == "--threads") {
+            args.threads = ParseList(argv[++i]);
+        } else if (arg == "--duration") {
+            args.duration = atof(argv[++i]);
+        } else if (arg == "--deadline") {
+            args.options.deadlineMs = atof(argv[++i]);
+        } else if (arg == "--sample-rate") {
+            args.options.analyzer.sampleRate = (float)atof(argv[++i]);
+        } else if (arg == "--detector") {
+            if (!Tuner::ParseDetector(argv[++i], args.options.analyzer.detector)) {
+                fprintf(stderr, "darktuna_server: unknown detector %s\n", argv[i]);
+                return false;
+            }
+        } else if (arg == "--accumulation") {
+            if (!Tuner::ParseAccumulation(argv[++i], args.options.analyzer.accumulation)) {
+                fprintf(stderr, "darktuna_server: unknown accumulation mode %s\n", argv[i]);
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (args.threads.empty()) {
+        args.threads.push_back((int)std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return true;
+}
+
+void PrintReportHeader() {
+    printf("%7s %7s %11s %9s %9s %9s %9s %9s %8s %10s %8s\n",
+        "threads", "streams", "analyses/s", "realtime", "p50 ms", "p99 ms", "p99.9 ms", "max ms",
+        "misses", "dropped", "steals");
+}
+
+void PrintReport(int threads, const ServerReport &report) {
+    double rate = report.seconds > 0.0 ? report.analyses / report.seconds : 0.0;
+    printf("%7d %7d %11.0f %8.1fx %9.3f %9.3f %9.3f %9.3f %8lld %10lld %8llu\n",
+        threads, report.streams, rate, report.realtimeFactor, report.p50, report.p99, report.p999,
+        report.max, report.deadlineMisses, report.droppedSamples, report.steals);
+}
+
+int RunSimulation(const Arguments &args) {
+    float sampleRate = args.options.analyzer.sampleRate;
+    double duration = args.duration > 0.0 ? args.duration : 5.0;
+    // A few seconds of a few dozen notes is plenty of variety to loop over
+    SignalBank bank(sampleRate, std::min(args.simulate, 36), 4.0f);
+
+    PrintReportHeader();
+    for (int threads : args.threads) {
+        ServerOptions options = args.options;
+        options.threads = threads;
+
+        StreamServer server(options);
+        for (int i = 0; i < args.simulate; ++i) {
+            server.AddStream(std::make_unique<SyntheticSource>(bank, i, sampleRate, args.paced));
+        }
+        server.Run(duration);
+        PrintReport(threads, server.GetReport());
+        fflush(stdout);
+    }
+    return 0;
+}
+
+int RunServer(const Arguments &args) {
+    ServerOptions options = args.options;
+    options.threads = args.threads.front();
+    StreamServer server(options);
+
+    SocketListener listener;
+    if (!args.listen.empty()) {
+        if (!listener.Open(args.listen)) {
+            fprintf(stderr, "darktuna_server: can't listen on %s\n", args.listen.c_str());
+            return 1;
+        }
+        server.SetListener(&listener);
+    }
+
+    for (const auto& path : args.fifos) {
+        int fd = OpenFifo(path);
+        if (fd < 0) {
+            fprintf(stderr, "darktuna_server: can't open fifo %s\n", path.c_str());
+            return 1;
+        }
+        server.AddStream(std::make_unique<FdSource>(fd, "fifo:" + path, false));
+    }
+
+    for (const auto& path : args.files) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file) {
+            fprintf(stderr, "darktuna_server: can't open %s\n", path.c_str());
+            return 1;
+        }
+        server.AddStream(std::make_unique<FileSource>(file, "file:" + path, options.analyzer.sampleRate));
+    }
+
+    server.Run(args.duration);
+
+    fprintf(stderr, "\n");
+    PrintReportHeader();
+    PrintReport(options.threads, server.GetReport());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Arguments args;
+    if (!ParseArguments(argc, argv, args)) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (args.simulate > 0) {
+        return RunSimulation(args);
+    }
+
+    if (args.listen.empty() && args.fifos.empty() && args.files.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    return RunServer(args);
+}
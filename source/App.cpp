@@ -10,11 +10,17 @@
 #include "imgui.h"
 #include "portaudio.h"
 
+#include "Analyzer.hpp"
+#include "Correlation.hpp"
+#include "FixedPoint.hpp"
 #include "Tuner.hpp"
 #include "Tunings.hpp"
 
 #include "logo.h"
 
+#include <algorithm>
+#include <ctime>
+
 SDL_Surface* CreateSurfaceFromIcon() {
     SDL_Surface* surface = SDL_CreateSurfaceFrom(
         LOGO_WIDTH,               // width
@@ -27,16 +33,34 @@ SDL_Surface* CreateSurfaceFromIcon() {
 }
 
 int App::AudioCallback(const void *input, void *, unsigned long frames,
-        const PaStreamCallbackTimeInfo *, PaStreamCallbackFlags, void *) {
+        const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags, void *) {
 
     App &instance = App::Get();
-    const float *in = (const float *)input;
-        for (unsigned long i = 0; i < frames; ++i) {
-        instance.mAudioBuffer[instance.mBufferIndex++] = *in++;
-        if (instance.mBufferIndex >= BUFFER_SIZE) {
-            instance.mBufferIndex = 0;
-            instance.mIsReadyForProcessing = true;
-        }
+
+    // Some host APIs leave the ADC time at 0, the callback time minus the
+    // buffer length is the next best guess
+    double adcTime = timeInfo->inputBufferAdcTime;
+    if (adcTime <= 0.0) {
+        adcTime = timeInfo->currentTime - (double)frames / SAMPLE_RATE;
+    }
+
+    // Float and 16 bit capture go in as they are, the pipeline keeps 16 bit
+    // samples for the Int16 detectors next to its float copy. 24 bit capture
+    // is converted in chunks first.
+    if (instance.mStreamFormat == paFloat32) {
+        instance.mPipeline.Push((const float *)input, (int)frames, adcTime);
+        return paContinue;
+    }
+    if (instance.mStreamFormat == paInt16) {
+        instance.mPipeline.Push((const int16_t *)input, (int)frames, adcTime);
+        return paContinue;
+    }
+
+    for (unsigned long offset = 0; offset < frames; offset += FRAMES_PER_BUFFER) {
+        int count = (int)std::min<unsigned long>(FRAMES_PER_BUFFER, frames - offset);
+        float *in = instance.mConvertBuffer;
+        Tuner::ConvertInt24((const uint8_t *)input + 3 * offset, count, in);
+        instance.mPipeline.Push(in, count, adcTime + (double)offset / SAMPLE_RATE);
     }
     return paContinue;
 }
@@ -50,13 +74,30 @@ void App::StartAudioStream(int deviceIndex) {
         mStream = nullptr;
     }
 
+    // Finish what the old stream left queued, then drop it with the rest of
+    // the timing: a new stream has its own clock
+    mPipeline.Flush();
+    mPendingReadings.clear();
+    mResultLatency.Clear();
+    mDisplayLatency.Clear();
+
     PaStreamParameters inputParams;
     inputParams.device = deviceIndex;
     inputParams.channelCount = 1;
-    inputParams.sampleFormat = paFloat32;
+    inputParams.sampleFormat = mCaptureFormat;
     inputParams.suggestedLatency = Pa_GetDeviceInfo(deviceIndex)->defaultLowInputLatency;
     inputParams.hostApiSpecificStreamInfo = nullptr;
 
+    // Capturing in the device's own format saves the driver a conversion,
+    // float still works everywhere
+    if (Pa_IsFormatSupported(&inputParams, nullptr, SAMPLE_RATE) != paFormatIsSupported) {
+        if (inputParams.sampleFormat != paFloat32) {
+            SDL_Log("Capture format not supported by the device, using float");
+        }
+        inputParams.sampleFormat = paFloat32;
+    }
+    mStreamFormat = inputParams.sampleFormat;
+
     PaError open_error = Pa_OpenStream(&mStream, &inputParams, nullptr, SAMPLE_RATE, FRAMES_PER_BUFFER, paNoFlag, AudioCallback, nullptr);
     if (open_error != paNoError) {
         SDL_Log("Failed to open stream: %s", Pa_GetErrorText(open_error));
@@ -67,6 +108,102 @@ void App::StartAudioStream(int deviceIndex) {
     }
 }
 
+void App::BuildPipeline() {
+    // Back to back windows, as many samples as the visualizer shows
+    Tuner::AnalyzerConfig config;
+    config.sampleRate = SAMPLE_RATE;
+    config.windowSize = BUFFER_SIZE;
+    config.hopSize = BUFFER_SIZE;
+    config.detector = mDetectorType;
+    config.accumulation = mAccumulation;
+    config.adaptiveGate = mAdaptiveGate;
+    config.rmsThreshold = mRmsThreshold;
+    config.preFilter = mPreFilterConfig;
+
+    // The strobe runs on the audio thread, the detector and what follows
+    // it on the UI thread
+    auto strobe = std::make_unique<Tuner::FunctionStage>(Tuner::StageType::Resolve, "strobe",
+        [this](Tuner::PipelineBlock &block) {
+            if (mStrobeMode.load(std::memory_order_relaxed)) {
+                mStrobe.Process(block.samples.data(), block.count);
+            }
+        });
+
+    mPipeline.Clear();
+    Tuner::AnalysisStages stages = Tuner::AddAnalysisStages(mPipeline, config, Tuner::StageRun::Pump,
+        [this](const Tuner::Reading &reading) {
+            OnReading(reading);
+        }, std::move(strobe));
+    mFilterStage = stages.filter;
+    mGateStage = stages.gate;
+    mDetectStage = stages.detect;
+
+    // Enough blocks to ride out a few slow frames, e.g. while the window
+    // is dragged around
+    Tuner::PipelineFormat format;
+    format.sampleRate = SAMPLE_RATE;
+    format.maxBlock = FRAMES_PER_BUFFER;
+    mPipeline.Prepare(format, 32);
+    mPowerSpectrum.Prepare(SAMPLE_RATE, BUFFER_SIZE);
+    mPendingReadings.reserve(32 * (FRAMES_PER_BUFFER / BUFFER_SIZE + 1));
+}
+
+void App::OnReading(const Tuner::Reading &reading) {
+    mVisualizer.SetWaveform(mDetectStage->GetWindow(), BUFFER_SIZE);
+    mSignalStrength = reading.rms;
+
+    // The adaptive gate skips analysis on hum, crowd noise and silence
+    if (!reading.voiced) return;
+    if (mShowSpectrum) {
+        // The detector's own when it made one, else computed just for the view
+        Tuner::SpectrumView spectrum = mDetectStage->GetDetector()->GetSpectrum();
+        if (!spectrum.power) {
+            spectrum = mPowerSpectrum.Process(mDetectStage->GetWindow(), BUFFER_SIZE);
+        }
+        mVisualizer.SetSpectrum(spectrum);
+    }
+
+    // Out of range keeps the last note up
+    if (!reading.note) return;
+    mDetectedFrequency = reading.frequency;
+    mConfidence = reading.confidence;
+    mCurrentNote = reading.note;
+    mCentsOff = reading.centsOff;
+
+    Tuner::RecordedReading recorded;
+    recorded.times = {reading.inputTime, GetStreamTime(), 0.0};
+    recorded.frequency = reading.frequency;
+    recorded.confidence = reading.confidence;
+    recorded.note = reading.note;
+    recorded.centsOff = reading.centsOff;
+    recorded.detector = reading.detector;
+    mPendingReadings.push_back(recorded);
+}
+
+void App::SetDetector(Tuner::DetectorType type) {
+    mDetectorType = type;
+    mDetectStage->SetDetector(type);
+    mVisualizer.SetSpectrum({});
+}
+
+double App::GetStreamTime() const {
+    return mStream ? Pa_GetStreamTime(mStream) : 0.0;
+}
+
+void App::ToggleRecording() {
+    if (mRecorder.IsOpen()) {
+        mRecorder.Close();
+        return;
+    }
+
+    char path[64];
+    time_t now = time(nullptr);
+    strftime(path, sizeof(path), "darktuna-%Y%m%d-%H%M%S.csv", localtime(&now));
+    if (!mRecorder.Open(path)) {
+        SDL_Log("Failed to open %s for recording", path);
+    }
+}
+
 bool App::Initialize() {
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -77,7 +214,7 @@ bool App::Initialize() {
     float display_scale = SDL_GetDisplayContentScale(SDL_GetPrimaryDisplay());
     SDL_WindowFlags window_flags = SDL_WINDOW_HIDDEN | SDL_WINDOW_HIGH_PIXEL_DENSITY;
 
-    mWindow = SDL_CreateWindow("Darktuna", 600, 300, window_flags);
+    mWindow = SDL_CreateWindow("Darktuna", 600, 560, window_flags);
     if (!mWindow) {
         SDL_Log("Failed to create SDL window: %s", SDL_GetError());
         return false;
@@ -123,6 +260,9 @@ bool App::Initialize() {
     Pa_Initialize();
     UpdateAudioDevices();
 
+    mStrobe.Prepare(SAMPLE_RATE);
+    BuildPipeline();
+
     // TODO: Load basic config file for settings
     if (!mAudioDevices.empty()) {
         mHostApiName = mAudioDevices.begin()->first;
@@ -132,6 +272,7 @@ bool App::Initialize() {
 }
 
 void App::Shutdown() {
+    mRecorder.Close();
     if (mStream) {
         Pa_StopStream(mStream);
         Pa_CloseStream(mStream);
@@ -159,26 +300,18 @@ void App::BeginFrame() {
 }
 
 void App::Update() {
-    if (mIsReadyForProcessing) {
-        // Calculate signal strength
-        mSignalStrength = 0.0f;
+    // Runs detection on what the audio callback queued up, readings come
+    // back through OnReading
+    mDetectStage->SetGate(mAdaptiveGate, mRmsThreshold);
+    mPipeline.Pump();
 
-        for (int i = 0; i < BUFFER_SIZE; ++i) {
-            mSignalStrength += mAudioBuffer[i] * mAudioBuffer[i];
-        }
-        mSignalStrength = sqrtf(mSignalStrength / BUFFER_SIZE);
-
-        if (mSignalStrength > mRmsThreshold) {
-            float detectedFrequency = Tuner::DetectFrequencyAutocorrelation(mAudioBuffer, BUFFER_SIZE, SAMPLE_RATE);
+    if (mStrobeMode && mCurrentNote) {
+        // Lock the strobe to the detected note, it resets itself when this changes
+        mStrobe.SetReference(mCurrentNote->freq);
 
-            if (detectedFrequency > 20.0f && detectedFrequency < 500.0f) {
-                mDetectedFrequency = detectedFrequency;
-                mCurrentNote = &Tuner::GetClosestNote(mDetectedFrequency);
-                mCentsOff = Tuner::GetCentsOff(mDetectedFrequency, mCurrentNote->freq);
-            }
+        if (mStrobe.IsLocked()) {
+            mCentsOff = mStrobe.GetCentsOff();
         }
-
-        mIsReadyForProcessing = false;
     }
 
     if (mNumAudioDevices != Pa_GetDeviceCount()) {
@@ -205,12 +338,112 @@ void App::Draw() {
                 ImGui::EndCombo();
             }
 
-            // Slider for RMS threshold
+            const char *detectorName = Tuner::GetDetectorInfo(mDetectorType).name;
+            if (ImGui::BeginCombo("Detector", detectorName)) {
+                for (const auto& info : Tuner::GetDetectorRegistry()) {
+                    bool isSelected = info.type == mDetectorType;
+                    if (ImGui::Selectable(info.name, isSelected)) {
+                        SetDetector(info.type);
+                    }
+
+                    if (isSelected) {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            const char *accumulationName = Tuner::GetAccumulationInfo(mAccumulation).name;
+            if (ImGui::BeginCombo("Accumulation", accumulationName)) {
+                for (const auto& info : Tuner::GetAccumulationModes()) {
+                    bool isSelected = info.accumulation == mAccumulation;
+                    if (ImGui::Selectable(info.name, isSelected)) {
+                        mAccumulation = info.accumulation;
+                        mDetectStage->SetAccumulation(mAccumulation);
+                    }
+
+                    if (isSelected) {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            static const PaSampleFormat kCaptureFormats[] = { paFloat32, paInt16, paInt24 };
+            static const char *kCaptureNames[] = { "Float 32", "Int 16", "Int 24" };
+            int captureIndex = 0;
+            for (int i = 0; i < 3; ++i) {
+                if (mCaptureFormat == kCaptureFormats[i]) {
+                    captureIndex = i;
+                }
+            }
+            if (ImGui::Combo("Capture format", &captureIndex, kCaptureNames, 3)) {
+                mCaptureFormat = kCaptureFormats[captureIndex];
+                if (mCurrentAudioDeviceIndex >= 0) {
+                    StartAudioStream(mCurrentAudioDeviceIndex);
+                }
+            }
+            if (mStream && mStreamFormat != mCaptureFormat) {
+                ImGui::TextDisabled("Not supported by the device, capturing float");
+            }
+
+            bool strobeMode = mStrobeMode;
+            if (ImGui::Checkbox("Strobe mode", &strobeMode)) {
+                mStrobeMode = strobeMode;
+                mStrobe.SetReference(0.0f);
+                mShowStrobe |= strobeMode;
+            }
+
+            ImGui::Checkbox("Adaptive noise gate", &mAdaptiveGate);
+
+            // Slider for RMS threshold, only used without the adaptive gate
+            ImGui::BeginDisabled(mAdaptiveGate);
             ImGui::SliderFloat("RMS Threshold", &mRmsThreshold, 0.0f, 0.02f, "%.4f");
+            ImGui::EndDisabled();
 
             // Slider for Cents Tolerance
             ImGui::SliderFloat("Cents Tolerance", &mCentsTolerance, 1.0f, 20.0f, "%.1f");
 
+            if (ImGui::CollapsingHeader("Pre-filter")) {
+                bool changed = ImGui::Checkbox("DC blocker", &mPreFilterConfig.dcBlocker);
+
+                static const float kMainsFrequencies[] = { 0.0f, 50.0f, 60.0f };
+                static const char *kMainsNames[] = { "Off", "50 Hz", "60 Hz" };
+                int mainsIndex = 0;
+                for (int i = 0; i < 3; ++i) {
+                    if (mPreFilterConfig.mainsFrequency == kMainsFrequencies[i]) {
+                        mainsIndex = i;
+                    }
+                }
+                if (ImGui::Combo("Mains notch", &mainsIndex, kMainsNames, 3)) {
+                    mPreFilterConfig.mainsFrequency = kMainsFrequencies[mainsIndex];
+                    changed = true;
+                }
+                changed |= ImGui::SliderInt("Harmonics", &mPreFilterConfig.mainsHarmonics, 1, 5);
+
+                changed |= ImGui::Checkbox("High-pass", &mPreFilterConfig.highPass);
+                changed |= ImGui::SliderFloat("High-pass cutoff", &mPreFilterConfig.highPassFrequency, 10.0f, 60.0f, "%.0f Hz");
+
+                if (changed) {
+                    mFilterStage->GetPreFilter().SetConfig(mPreFilterConfig);
+                }
+            }
+
+            // Where each stage runs and how long it takes per block
+            if (ImGui::CollapsingHeader("Pipeline")) {
+                static const char *kRunNames[] = { "audio thread", "own thread", "UI thread" };
+                for (const auto& timing : mPipeline.GetTimings()) {
+                    ImGui::Text("%-8s %-12s %7.1f us, max %7.1f us", timing.name, kRunNames[(int)timing.run],
+                        timing.meanUs, timing.maxUs);
+                }
+                if (mPipeline.GetDroppedSamples() > 0) {
+                    ImGui::TextDisabled("%lld samples dropped", mPipeline.GetDroppedSamples());
+                }
+                if (ImGui::Button("Reset timings")) {
+                    mPipeline.ResetTimings();
+                }
+            }
+
             ImGui::Separator();
             if (ImGui::Button("Close")) {
                 mShowSettingsMenu = false;
@@ -221,6 +454,17 @@ void App::Draw() {
             if (ImGui::Button("Reset to defaults")) {
                 mRmsThreshold = 0.01f;
                 mCentsTolerance = 5.0f;
+                mAccumulation = Tuner::Accumulation::Float;
+                mDetectStage->SetAccumulation(mAccumulation);
+                SetDetector(Tuner::DetectorType::Auto);
+                if (mCaptureFormat != paFloat32 && mCurrentAudioDeviceIndex >= 0) {
+                    mCaptureFormat = paFloat32;
+                    StartAudioStream(mCurrentAudioDeviceIndex);
+                }
+                mStrobeMode = false;
+                mAdaptiveGate = true;
+                mPreFilterConfig = Tuner::PreFilterConfig();
+                mFilterStage->GetPreFilter().SetConfig(mPreFilterConfig);
             }
 
             ImGui::End();
@@ -234,6 +478,11 @@ void App::Draw() {
                 mShowSettingsMenu = true;
             }
 
+            // Every reading goes to a CSV track with its timing
+            if (ImGui::MenuItem("Record readings", nullptr, mRecorder.IsOpen())) {
+                ToggleRecording();
+            }
+
             if (ImGui::MenuItem("Exit")) {
                 SDL_Event quit_event = { .type = SDL_EVENT_QUIT };
                 SDL_PushEvent(&quit_event);
@@ -241,6 +490,15 @@ void App::Draw() {
             ImGui::EndMenu();
         }
 
+        if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Waveform", nullptr, &mShowWaveform);
+            ImGui::MenuItem("Spectrum", nullptr, &mShowSpectrum);
+            ImGui::MenuItem("Cents needle", nullptr, &mShowNeedle);
+            ImGui::MenuItem("Strobe", nullptr, &mShowStrobe);
+            ImGui::MenuItem("Latency", nullptr, &mShowLatency);
+            ImGui::EndMenu();
+        }
+
         if (ImGui::BeginMenu("Devices")) {
             for (auto pair : mAudioDevices[mHostApiName]) {
                 bool isSelected = (mCurrentAudioDeviceIndex == pair.first);
@@ -276,7 +534,14 @@ void App::Draw() {
         ImGuiWindowFlags_NoCollapse);
 
     float content_width = 400.0f;
-    float content_height = 180.0f;
+    // The text readout, one line taller with the latency shown
+    float text_height = 180.0f + (mShowLatency ? ImGui::GetTextLineHeightWithSpacing() : 0.0f);
+    float content_height = text_height;
+
+    // Visualizer panels are stacked under the text readout
+    const float panel_height = 70.0f;
+    int num_panels = (int)mShowWaveform + (int)mShowSpectrum + (int)mShowNeedle + (int)mShowStrobe;
+    content_height += num_panels * (panel_height + ImGui::GetStyle().ItemSpacing.y);
 
     // Compute top-left corner for centered layout
     ImVec2 content_pos = ImVec2(
@@ -315,11 +580,31 @@ void App::Draw() {
 
     // Show RMS value
     ImGui::Text("Strength (RMS): %.6f\n", mSignalStrength);
+    if (mAdaptiveGate) {
+        ImGui::SameLine();
+        const Tuner::NoiseGate &gate = mGateStage->GetNoiseGate();
+        ImGui::TextDisabled("floor %.6f%s", gate.GetNoiseFloor(), gate.IsVoiced() ? ", voiced" : "");
+    }
+
+    // Age of the reading from the ADC to the result and to the screen
+    if (mShowLatency) {
+        if (mDisplayLatency.GetCount() > 0) {
+            ImGui::TextDisabled("Latency: %.1f ms to result, %.1f ms to screen (p95 %.1f ms)%s",
+                mResultLatency.GetLast() * 1000.0, mDisplayLatency.GetLast() * 1000.0,
+                mDisplayLatency.GetPercentile(0.95) * 1000.0, mRecorder.IsOpen() ? ", recording" : "");
+        } else {
+            ImGui::TextDisabled("Latency: no readings yet%s", mRecorder.IsOpen() ? ", recording" : "");
+        }
+    }
 
     if (mCurrentNote) {
-        ImGui::Text("Detected: %.2f Hz", mDetectedFrequency);
+        ImGui::Text("Detected: %.2f Hz (confidence %.2f)", mDetectedFrequency, mConfidence);
         ImGui::Text("Note: %s (%.2f Hz)", mCurrentNote->name.c_str(), mCurrentNote->freq);
-        ImGui::Text("Cents off: %.2f", mCentsOff);
+        if (mStrobeMode && mStrobe.IsLocked()) {
+            ImGui::Text("Cents off: %+.2f (strobe)", mCentsOff);
+        } else {
+            ImGui::Text("Cents off: %.2f", mCentsOff);
+        }
 
         // Color and tuning direction indicator
         if (std::abs(mCentsOff) < mCentsTolerance) {
@@ -341,6 +626,27 @@ void App::Draw() {
         ImGui::Text("Listening...");
     }
 
+    // Push the panels below the tallest text block so they don't jump around
+    ImGui::SetCursorPosY(std::max(ImGui::GetCursorPosY(), text_height));
+    ImVec2 panel_size = ImVec2(content_width, panel_height);
+
+    if (mShowWaveform) {
+        mVisualizer.DrawWaveform(panel_size);
+    }
+    if (mShowSpectrum) {
+        mVisualizer.DrawSpectrum(panel_size);
+    }
+    if (mShowNeedle) {
+        mVisualizer.DrawNeedle(panel_size, mCentsOff, mCentsTolerance, mCurrentNote != nullptr);
+    }
+    if (mShowStrobe) {
+        if (mStrobeMode) {
+            mVisualizer.DrawPhaseStrobe(panel_size, mStrobe.GetPhase(), mCentsOff, mCentsTolerance, mStrobe.IsLocked());
+        } else {
+            mVisualizer.DrawStrobe(panel_size, mCentsOff, mCentsTolerance, mCurrentNote != nullptr);
+        }
+    }
+
     ImGui::EndChild();
     ImGui::End();
 }
@@ -353,6 +659,17 @@ void App::EndFrame() {
     SDL_RenderClear(mRenderer);
     ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), mRenderer);
     SDL_RenderPresent(mRenderer);
+
+    // Every reading since the last frame is on screen now, the older ones
+    // only as far as the newest replaced them
+    double presented = GetStreamTime();
+    for (auto& recorded : mPendingReadings) {
+        recorded.times.presented = presented;
+        mResultLatency.Add(recorded.times.GetResultLatency());
+        mDisplayLatency.Add(recorded.times.GetDisplayLatency());
+        mRecorder.Write(recorded);
+    }
+    mPendingReadings.clear();
 }
 
 void App::UpdateAudioDevices() {
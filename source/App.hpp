@@ -1,12 +1,23 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "SDL3/SDL_events.h"
 #include "portaudio.h"
 #include "Note.hpp"
+#include "Latency.hpp"
+#include "Pipeline.hpp"
+#include "PipelineStages.hpp"
+#include "PitchDetector.hpp"
+#include "PreFilter.hpp"
+#include "Strobe.hpp"
+#include "TrackRecorder.hpp"
+#include "Visualizer.hpp"
 
 // Forward declarations
 struct SDL_Window;
@@ -30,21 +41,57 @@ private:
     std::unordered_map<std::string, std::map<int, std::string>> mAudioDevices;
 
     // Audio stream
-    float mAudioBuffer[BUFFER_SIZE];
-    int mBufferIndex = 0;
-    bool mIsReadyForProcessing = false;
+    // 24 bit capture converted to float, a chunk at a time
+    float mConvertBuffer[FRAMES_PER_BUFFER];
     PaStream *mStream = nullptr;
+    // Sample format asked for and the one the stream got, the device may
+    // not support the former and fall back to float
+    PaSampleFormat mCaptureFormat = paFloat32;
+    PaSampleFormat mStreamFormat = paFloat32;
+
+    // Filter, gate and strobe run in the audio callback, detection and the
+    // stages after it in Update, where the detector and the visualizer
+    // belong to the UI thread
+    Tuner::Pipeline mPipeline;
+    Tuner::FilterStage *mFilterStage = nullptr;
+    Tuner::GateStage *mGateStage = nullptr;
+    Tuner::DetectStage *mDetectStage = nullptr;
+    Tuner::PreFilterConfig mPreFilterConfig;
+    Tuner::DetectorType mDetectorType = Tuner::DetectorType::Auto;
+    Tuner::Accumulation mAccumulation = Tuner::Accumulation::Float;
+
+    // Heterodyne strobe, fed per sample from the audio callback
+    Tuner::Strobe mStrobe;
+    std::atomic<bool> mStrobeMode{false};
+
+    // Spectrum view for detectors that don't compute one
+    Tuner::PowerSpectrum mPowerSpectrum;
 
     // Audio state
     float mDetectedFrequency = 0.0f;
+    float mConfidence = 0.0f;
     const Note* mCurrentNote = nullptr;
     float mCentsOff = 0.0f;
     float mSignalStrength = 0.0f;
 
+    // Readings and their timing, pending until a frame has shown them.
+    // Reserved for what a full pipeline queue can publish in one Update.
+    std::vector<Tuner::RecordedReading> mPendingReadings;
+    Tuner::LatencyHistory mResultLatency;
+    Tuner::LatencyHistory mDisplayLatency;
+    Tuner::TrackRecorder mRecorder;
+
     // UI state
     bool mShowSettingsMenu = false;
+    bool mShowWaveform = true;
+    bool mShowSpectrum = true;
+    bool mShowNeedle = true;
+    bool mShowStrobe = false;
+    bool mShowLatency = true;
+    Visualizer mVisualizer;
 
     // User settings
+    bool mAdaptiveGate = true;    // Noise floor tracking instead of a fixed threshold
     float mRmsThreshold = 0.01f;  // Minimum signal strength to consider
     float mCentsTolerance = 5.0f; // How close to the note before "in tune"
 
@@ -55,6 +102,13 @@ private:
     static int AudioCallback(const void *input, void *, unsigned long frames,
         const PaStreamCallbackTimeInfo *, PaStreamCallbackFlags, void *);
     void StartAudioStream(int deviceIndex);
+    void BuildPipeline();
+    // Publish stage, runs in Update
+    void OnReading(const Tuner::Reading &reading);
+    void SetDetector(Tuner::DetectorType type);
+    // PortAudio stream time, the clock the ADC times are on
+    double GetStreamTime() const;
+    void ToggleRecording();
 
 public:
     static App& Get() {
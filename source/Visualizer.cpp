@@ -0,0 +1,237 @@
+#include "Visualizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const ImU32 kTraceColor = IM_COL32(214, 93, 14, 255);  // Gruvbox orange
+const ImU32 kInTuneColor = IM_COL32(0, 255, 0, 255);
+const ImU32 kGridColor = IM_COL32(64, 64, 64, 255);
+const ImU32 kLabelColor = IM_COL32(128, 128, 128, 255);
+const ImU32 kBackgroundColor = IM_COL32(26, 26, 26, 255);
+
+// Highest frequency shown, guitar harmonics above this are not interesting
+const float kSpectrumMaxFrequency = 2000.0f;
+const float kSpectrumRangeDb = 80.0f;
+
+// Reserves a panel in the layout and draws its background
+ImDrawList *BeginPanel(ImVec2 size, const char *label, ImVec2 &origin) {
+    origin = ImGui::GetCursorScreenPos();
+    ImGui::Dummy(size);
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 end = ImVec2(origin.x + size.x, origin.y + size.y);
+    drawList->AddRectFilled(origin, end, kBackgroundColor);
+    drawList->AddText(ImVec2(origin.x + 4, origin.y + 2), kLabelColor, label);
+    return drawList;
+}
+
+} // namespace
+
+bool Visualizer::Trace::NeedsRebuild(ImVec2 newOrigin, ImVec2 newSize) const {
+    return dirty ||
+        origin.x != newOrigin.x || origin.y != newOrigin.y ||
+        size.x != newSize.x || size.y != newSize.y;
+}
+
+void Visualizer::SetWaveform(const float *samples, int size) {
+    mSamples = samples;
+    mNumSamples = size;
+    mWaveformTrace.dirty = true;
+}
+
+void Visualizer::SetSpectrum(const Tuner::SpectrumView &spectrum) {
+    mSpectrum = spectrum;
+    mSpectrumTrace.dirty = true;
+}
+
+void Visualizer::DrawWaveform(ImVec2 size) {
+    ImVec2 origin;
+    ImDrawList *drawList = BeginPanel(size, "Waveform", origin);
+
+    float midY = origin.y + size.y * 0.5f;
+    drawList->AddLine(ImVec2(origin.x, midY), ImVec2(origin.x + size.x, midY), kGridColor);
+
+    if (mWaveformTrace.NeedsRebuild(origin, size)) {
+        mWaveformTrace.origin = origin;
+        mWaveformTrace.size = size;
+        RebuildWaveform();
+    }
+
+    const auto& points = mWaveformTrace.points;
+    if (!points.empty()) {
+        drawList->AddPolyline(points.data(), (int)points.size(), kTraceColor, ImDrawFlags_None, 1.0f);
+    }
+}
+
+void Visualizer::DrawSpectrum(ImVec2 size) {
+    ImVec2 origin;
+    ImDrawList *drawList = BeginPanel(size, "Spectrum", origin);
+
+    // Octave grid lines at the A's
+    float logMin = log2f(Tuner::kMinFrequency);
+    float logRange = log2f(kSpectrumMaxFrequency) - logMin;
+    for (float freq = 27.5f; freq < kSpectrumMaxFrequency; freq *= 2.0f) {
+        float x = origin.x + (log2f(freq) - logMin) / logRange * size.x;
+        drawList->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + size.y), kGridColor);
+    }
+
+    if (mSpectrumTrace.NeedsRebuild(origin, size)) {
+        mSpectrumTrace.origin = origin;
+        mSpectrumTrace.size = size;
+        RebuildSpectrum();
+    }
+
+    const auto& points = mSpectrumTrace.points;
+    if (!points.empty()) {
+        drawList->AddPolyline(points.data(), (int)points.size(), kTraceColor, ImDrawFlags_None, 1.0f);
+    } else {
+        drawList->AddText(ImVec2(origin.x + 4, origin.y + size.y * 0.5f), kLabelColor,
+            "No spectrum yet, the Auto and FFT detectors provide one");
+    }
+}
+
+void Visualizer::DrawNeedle(ImVec2 size, float cents, float tolerance, bool active) {
+    const float pi = 3.14159265f;
+    const float sweep = pi / 3.0f; // +-50 cents maps to +-60 degrees
+
+    ImVec2 origin;
+    ImDrawList *drawList = BeginPanel(size, "Cents", origin);
+
+    ImVec2 center = ImVec2(origin.x + size.x * 0.5f, origin.y + size.y - 4.0f);
+    float radius = std::min(size.x * 0.5f, size.y - 8.0f);
+    float up = -pi * 0.5f;
+
+    drawList->PathArcTo(center, radius, up - sweep, up + sweep, 32);
+    drawList->PathStroke(kGridColor, ImDrawFlags_None, 2.0f);
+
+    float zone = std::min(tolerance / 50.0f, 1.0f) * sweep;
+    drawList->PathArcTo(center, radius, up - zone, up + zone, 16);
+    drawList->PathStroke(kInTuneColor, ImDrawFlags_None, 4.0f);
+
+    if (active) {
+        float angle = up + std::clamp(cents / 50.0f, -1.0f, 1.0f) * sweep;
+        ImVec2 tip = ImVec2(center.x + cosf(angle) * radius, center.y + sinf(angle) * radius);
+        ImU32 color = fabsf(cents) < tolerance ? kInTuneColor : kTraceColor;
+        drawList->AddLine(center, tip, color, 2.0f);
+    }
+}
+
+void Visualizer::DrawStrobe(ImVec2 size, float cents, float tolerance, bool active) {
+    // Bands move one band width per second per cent
+    if (active) {
+        mStrobePhase += cents * ImGui::GetIO().DeltaTime;
+        mStrobePhase -= floorf(mStrobePhase);
+    }
+
+    ImU32 color = !active ? kGridColor : (fabsf(cents) < tolerance ? kInTuneColor : kTraceColor);
+    DrawStrobeBands(size, "Strobe", mStrobePhase, color);
+}
+
+void Visualizer::DrawPhaseStrobe(ImVec2 size, float phase, float cents, float tolerance, bool active) {
+    ImU32 color = !active ? kGridColor : (fabsf(cents) < tolerance ? kInTuneColor : kTraceColor);
+    DrawStrobeBands(size, "Strobe (heterodyne)", phase, color);
+}
+
+void Visualizer::DrawStrobeBands(ImVec2 size, const char *label, float phase, ImU32 color) {
+    const int kBands = 8;
+
+    ImVec2 origin;
+    ImDrawList *drawList = BeginPanel(size, label, origin);
+
+    // One band width per cycle of phase
+    float bandWidth = size.x / kBands;
+    float offset = (phase - floorf(phase)) * bandWidth;
+    float top = origin.y + size.y * 0.3f;
+    float bottom = origin.y + size.y * 0.7f;
+
+    ImVec2 end = ImVec2(origin.x + size.x, origin.y + size.y);
+    drawList->PushClipRect(origin, end, true);
+    for (int i = -1; i < kBands; ++i) {
+        float x = origin.x + offset + i * bandWidth;
+        drawList->AddRectFilled(ImVec2(x, top), ImVec2(x + bandWidth * 0.5f, bottom), color);
+    }
+    drawList->PopClipRect();
+}
+
+void Visualizer::RebuildWaveform() {
+    // Built for the current data even when there is nothing to draw, so
+    // an empty trace isn't rebuilt every frame
+    auto& points = mWaveformTrace.points;
+    points.clear();
+    mWaveformTrace.dirty = false;
+
+    ImVec2 origin = mWaveformTrace.origin;
+    ImVec2 size = mWaveformTrace.size;
+    int columns = (int)size.x;
+    if (!mSamples || mNumSamples <= 0 || columns <= 0) return;
+
+    float peak = 0.05f;
+    for (int i = 0; i < mNumSamples; ++i) {
+        peak = std::max(peak, fabsf(mSamples[i]));
+    }
+    float scale = size.y * 0.5f / peak;
+    float midY = origin.y + size.y * 0.5f;
+
+    // Min/max per column draws the full envelope without aliasing
+    for (int c = 0; c < columns; ++c) {
+        int begin = (int)((long long)c * mNumSamples / columns);
+        int end = std::max(begin + 1, (int)((long long)(c + 1) * mNumSamples / columns));
+
+        float low = mSamples[begin];
+        float high = mSamples[begin];
+        for (int i = begin + 1; i < end && i < mNumSamples; ++i) {
+            low = std::min(low, mSamples[i]);
+            high = std::max(high, mSamples[i]);
+        }
+
+        float x = origin.x + (float)c;
+        points.push_back(ImVec2(x, midY - high * scale));
+        points.push_back(ImVec2(x, midY - low * scale));
+    }
+}
+
+void Visualizer::RebuildSpectrum() {
+    auto& points = mSpectrumTrace.points;
+    points.clear();
+    mSpectrumTrace.dirty = false;
+
+    ImVec2 origin = mSpectrumTrace.origin;
+    ImVec2 size = mSpectrumTrace.size;
+    int columns = (int)size.x;
+    if (!mSpectrum.power || mSpectrum.bins <= 1 || columns <= 0) return;
+
+    float highest = 1e-20f;
+    for (int i = 1; i < mSpectrum.bins; ++i) {
+        highest = std::max(highest, mSpectrum.power[i]);
+    }
+
+    float logMin = log2f(Tuner::kMinFrequency);
+    float logRange = log2f(kSpectrumMaxFrequency) - logMin;
+    int lastBin = mSpectrum.bins - 1;
+
+    for (int c = 0; c < columns; ++c) {
+        float lowBin = exp2f(logMin + logRange * c / columns) / mSpectrum.binHz;
+        float highBin = exp2f(logMin + logRange * (c + 1) / columns) / mSpectrum.binHz;
+        if (lowBin >= lastBin) break;
+
+        float power;
+        if (highBin - lowBin < 1.0f) {
+            // Several columns per bin at the low end, interpolate between bins
+            int bin = (int)lowBin;
+            float frac = lowBin - bin;
+            power = mSpectrum.power[bin] * (1.0f - frac) + mSpectrum.power[bin + 1] * frac;
+        } else {
+            // Several bins per column at the high end, keep the peaks
+            power = 0.0f;
+            for (int bin = (int)lowBin; bin <= (int)highBin && bin <= lastBin; ++bin) {
+                power = std::max(power, mSpectrum.power[bin]);
+            }
+        }
+
+        float db = 10.0f * log10f(std::max(power / highest, 1e-10f));
+        float level = std::clamp(1.0f + db / kSpectrumRangeDb, 0.0f, 1.0f);
+        points.push_back(ImVec2(origin.x + (float)c, origin.y + size.y * (1.0f - level)));
+    }
+}
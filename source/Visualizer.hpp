@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "imgui.h"
+#include "PitchDetector.hpp"
+
+// Draws the buffers the analysis already computed. Traces are decimated to
+// one point per pixel column and only rebuilt when a new analysis frame
+// arrives or the panel moves, so idle frames replay cached polylines.
+struct Visualizer {
+public:
+    // Pointers must stay valid until the next call
+    void SetWaveform(const float *samples, int size);
+    void SetSpectrum(const Tuner::SpectrumView &spectrum);
+
+    void DrawWaveform(ImVec2 size);
+    void DrawSpectrum(ImVec2 size);
+    void DrawNeedle(ImVec2 size, float cents, float tolerance, bool active);
+    // Strobe animated from the cents reading
+    void DrawStrobe(ImVec2 size, float cents, float tolerance, bool active);
+    // Strobe driven by a measured heterodyne phase in cycles
+    void DrawPhaseStrobe(ImVec2 size, float phase, float cents, float tolerance, bool active);
+
+private:
+    struct Trace {
+        std::vector<ImVec2> points;
+        ImVec2 origin = ImVec2(0, 0);
+        ImVec2 size = ImVec2(0, 0);
+        bool dirty = true;
+
+        bool NeedsRebuild(ImVec2 newOrigin, ImVec2 newSize) const;
+    };
+
+    const float *mSamples = nullptr;
+    int mNumSamples = 0;
+    Tuner::SpectrumView mSpectrum;
+
+    Trace mWaveformTrace;
+    Trace mSpectrumTrace;
+    float mStrobePhase = 0.0f;
+
+    void DrawStrobeBands(ImVec2 size, const char *label, float phase, ImU32 color);
+    void RebuildWaveform();
+    void RebuildSpectrum();
+};
@@ -0,0 +1,62 @@
+#include "Analyzer.hpp"
+
+Tuner::AnalysisStages Tuner::AddAnalysisStages(Pipeline &pipeline, const AnalyzerConfig &config, StageRun detectRun,
+    PublishStage::Callback publish, std::unique_ptr<PipelineStage> tap) {
+    AnalysisStages stages;
+    stages.filter = &pipeline.Add(std::make_unique<FilterStage>(config.preFilter));
+    if (config.decimate) {
+        pipeline.Add(std::make_unique<DecimateStage>());
+    }
+    stages.gate = &pipeline.Add(std::make_unique<GateStage>());
+    if (tap) {
+        pipeline.Add(std::move(tap));
+    }
+
+    DetectConfig detect;
+    detect.windowSize = config.windowSize;
+    detect.hopSize = config.hopSize;
+    detect.detector = config.detector;
+    detect.accumulation = config.accumulation;
+    detect.adaptiveGate = config.adaptiveGate;
+    detect.rmsThreshold = config.rmsThreshold;
+    stages.detect = &pipeline.Add(std::make_unique<DetectStage>(detect), detectRun);
+
+    pipeline.Add(std::make_unique<TrackStage>());
+    pipeline.Add(std::make_unique<ResolveStage>());
+    pipeline.Add(std::make_unique<PublishStage>(std::move(publish)));
+    return stages;
+}
+
+void Tuner::Analyzer::Prepare(const AnalyzerConfig &config) {
+    mConfig = config;
+
+    mPipeline.Clear();
+    mDetect = AddAnalysisStages(mPipeline, config, StageRun::Inline, [this](const AnalyzerResult &result) {
+        mLatest = result;
+        mAnalyzed = true;
+    }).detect;
+
+    // Everything runs inline, so one block is all it takes
+    PipelineFormat format;
+    format.sampleRate = config.sampleRate;
+    format.maxBlock = kAnalysisBlock;
+    mPipeline.Prepare(format, 1);
+}
+
+bool Tuner::Analyzer::Process(const float *samples, int count, AnalyzerResult &result, double time) {
+    mAnalyzed = false;
+    mPipeline.Push(samples, count, time);
+    if (mAnalyzed) {
+        result = mLatest;
+    }
+    return mAnalyzed;
+}
+
+bool Tuner::Analyzer::Process(const int16_t *samples, int count, AnalyzerResult &result, double time) {
+    mAnalyzed = false;
+    mPipeline.Push(samples, count, time);
+    if (mAnalyzed) {
+        result = mLatest;
+    }
+    return mAnalyzed;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "Pipeline.hpp"
+#include "PipelineStages.hpp"
+#include "PitchDetector.hpp"
+#include "PreFilter.hpp"
+
+namespace Tuner {
+
+struct AnalyzerConfig {
+    float sampleRate = 44100.0f;
+    // Samples per analysis and samples between analyses
+    int windowSize = 2048;
+    int hopSize = 2048;
+    DetectorType detector = DetectorType::Auto;
+    // For the correlation and RMS sums, worth raising for long windows
+    Accumulation accumulation = Accumulation::Float;
+    // Adaptive gate, or a fixed RMS threshold when off
+    bool adaptiveGate = true;
+    float rmsThreshold = 0.01f;
+    PreFilterConfig preFilter;
+    // Halve the rate ahead of the gate and detector, windowSize and hopSize
+    // are then at the lower rate. For high rates, where the detector would
+    // otherwise need long windows to see low notes.
+    bool decimate = false;
+};
+
+// Largest block the analysis stages are fed with, also what the gate
+// measures
+constexpr int kAnalysisBlock = 512;
+
+// Readings come out of the pipeline as they are
+using AnalyzerResult = Reading;
+
+// The stages AddAnalysisStages added that can be tuned while it runs
+struct AnalysisStages {
+    FilterStage *filter = nullptr;
+    GateStage *gate = nullptr;
+    DetectStage *detect = nullptr;
+};
+
+// Adds the stages Analyzer runs to pipeline: filter, decimate when asked
+// for, gate, detect, track, resolve and publish. detectRun is where the
+// detect stage runs, the ones after it follow inline. tap, when given, runs
+// inline right before detect on the audio the detector gets.
+AnalysisStages AddAnalysisStages(Pipeline &pipeline, const AnalyzerConfig &config, StageRun detectRun,
+    PublishStage::Callback publish, std::unique_ptr<PipelineStage> tap = nullptr);
+
+// The complete analysis chain for one stream of audio, on a pipeline that
+// runs every stage inline. Takes blocks of any size from the caller and
+// allocates nothing after Prepare.
+class Analyzer {
+public:
+    void Prepare(const AnalyzerConfig &config);
+
+    // Returns true when at least one window was analyzed, result then holds
+    // the newest one. time is when samples[0] was captured, in seconds on
+    // any clock, e.g. PortAudio's inputBufferAdcTime.
+    bool Process(const float *samples, int count, AnalyzerResult &result, double time = 0.0);
+    // Same for 16 bit capture, which reaches the Int16 detectors as it is
+    // when neither the pre-filter nor decimation changes it
+    bool Process(const int16_t *samples, int count, AnalyzerResult &result, double time = 0.0);
+
+    inline const AnalyzerConfig& GetConfig() const {
+        return mConfig;
+    }
+
+    inline PitchDetector *GetDetector() const {
+        return mDetect ? mDetect->GetDetector() : nullptr;
+    }
+
+    inline std::vector<StageTiming> GetTimings() const {
+        return mPipeline.GetTimings();
+    }
+
+private:
+    AnalyzerConfig mConfig;
+    Pipeline mPipeline;
+    DetectStage *mDetect = nullptr;
+
+    // Set by the publish stage during Process
+    AnalyzerResult mLatest;
+    bool mAnalyzed = false;
+};
+
+} // namespace Tuner
@@ -0,0 +1,342 @@
+#include "Correlation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "FixedPoint.hpp"
+
+namespace {
+
+// Register tile: 8 lags times 4 lanes is 8 SSE accumulators, which leaves
+// room for the loads. Wider tiles or more lanes spill on x86-64. Every mode
+// uses the float tile width. Double and Kahan spill at 8 lags, but loading
+// each sample once for 8 lags still beats narrower tiles.
+constexpr int kCorrelationLanes = 4;
+constexpr int kTile = 8;
+
+// Adds buffer[i] * buffer[i + lag + k] for i in [begin, end) to sums[k], for
+// the Tile lags from lag on. Every lag keeps kCorrelationLanes partial sums,
+// which lets the compiler vectorize without reassociating float adds, and
+// each sample is loaded once for the whole tile. Stops at the last whole
+// group of lanes and returns where, the rest is left to the caller.
+// Products and sums are in Sum precision.
+template <int Tile, typename Sum = float>
+int AccumulateLanes(const float *buffer, int begin, int end, int lag, Sum *sums) {
+    constexpr int kLanes = kCorrelationLanes;
+
+    Sum acc[Tile][kLanes] = {};
+    int i = begin;
+    for (; i + kLanes <= end; i += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+            Sum x = buffer[i + l];
+            for (int k = 0; k < Tile; ++k) {
+                acc[k][l] += x * (Sum)buffer[i + lag + k + l];
+            }
+        }
+    }
+
+    for (int k = 0; k < Tile; ++k) {
+        for (int l = 0; l < kLanes; ++l) {
+            sums[k] += acc[k][l];
+        }
+    }
+    return i;
+}
+
+// Adds each lag's whole overlap to sums
+template <int Tile, typename Sum = float>
+void FinishTile(const float *buffer, int size, int lag, Sum *sums) {
+    // Terms every lag of the tile has, then the ones only shorter lags have
+    int i = AccumulateLanes<Tile, Sum>(buffer, 0, size - lag - (Tile - 1), lag, sums);
+    for (int k = 0; k < Tile; ++k) {
+        for (int j = i; j < size - lag - k; ++j) {
+            sums[k] += (Sum)buffer[j] * (Sum)buffer[j + lag + k];
+        }
+    }
+}
+
+// Samples summed in float before the pairwise and mixed modes combine them,
+// few enough that the block sums keep nearly all their bits
+constexpr int kSumBlock = 256;
+// Enough cascade levels for 2^31 samples
+constexpr int kCascadeLevels = 24;
+
+// Calls function(tile, lag) with a std::integral_constant tile width for
+// whole tiles of lags, then one lag at a time for the rest
+template <int Tile, typename Function>
+void ForEachTile(int beginLag, int endLag, Function function) {
+    int lag = beginLag;
+    for (; lag + Tile <= endLag; lag += Tile) {
+        function(std::integral_constant<int, Tile>(), lag);
+    }
+    for (; lag < endLag; ++lag) {
+        function(std::integral_constant<int, 1>(), lag);
+    }
+}
+
+// Hands the float sums of each kSumBlock samples of the tile to combine, the
+// terms only the shorter lags have come last as a block of their own
+template <int Tile, typename Combine>
+void AccumulateBlocks(const float *buffer, int size, int lag, Combine combine) {
+    int end = size - lag - (Tile - 1);
+    for (int begin = 0; begin < end; begin += kSumBlock) {
+        int blockEnd = std::min(begin + kSumBlock, end);
+        float sums[Tile] = {};
+        int i = AccumulateLanes<Tile>(buffer, begin, blockEnd, lag, sums);
+        for (int k = 0; k < Tile; ++k) {
+            for (int j = i; j < blockEnd; ++j) {
+                sums[k] += buffer[j] * buffer[j + lag + k];
+            }
+        }
+        combine(sums);
+    }
+
+    float sums[Tile] = {};
+    for (int k = 0; k < Tile; ++k) {
+        for (int j = std::max(end, 0); j < size - lag - k; ++j) {
+            sums[k] += buffer[j] * buffer[j + lag + k];
+        }
+    }
+    combine(sums);
+}
+
+// Pairwise sum of a stream of values as a binary counter, level l holds the
+// sum of the last 2^l values when bit l of the count is set
+template <int Tile>
+struct Cascade {
+    float levels[kCascadeLevels][Tile];
+    unsigned count = 0;
+
+    void Add(const float *values) {
+        float carry[Tile];
+        std::copy(values, values + Tile, carry);
+
+        int level = 0;
+        for (unsigned n = count; n & 1; n >>= 1, ++level) {
+            for (int k = 0; k < Tile; ++k) {
+                carry[k] += levels[level][k];
+            }
+        }
+        std::copy(carry, carry + Tile, levels[level]);
+        ++count;
+    }
+
+    void Finish(float *sums) const {
+        std::fill(sums, sums + Tile, 0.0f);
+        for (int level = 0; level < kCascadeLevels; ++level) {
+            if (count & (1u << level)) {
+                for (int k = 0; k < Tile; ++k) {
+                    sums[k] += levels[level][k];
+                }
+            }
+        }
+    }
+};
+
+inline void KahanAdd(float &sum, float &compensation, float value) {
+    float y = value - compensation;
+    float t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+}
+
+// Tiles store to float for the correlation and to double for SumSquares
+
+template <int Tile, typename Out>
+void CorrelateTileFloat(const float *buffer, int size, int lag, Out *correlation) {
+    float sums[Tile] = {};
+    FinishTile<Tile>(buffer, size, lag, sums);
+    std::copy(sums, sums + Tile, correlation + lag);
+}
+
+template <int Tile, typename Out>
+void CorrelateTileDouble(const float *buffer, int size, int lag, Out *correlation) {
+    double sums[Tile] = {};
+    FinishTile<Tile, double>(buffer, size, lag, sums);
+    for (int k = 0; k < Tile; ++k) {
+        correlation[lag + k] = (Out)sums[k];
+    }
+}
+
+template <int Tile, typename Out>
+void CorrelateTilePairwise(const float *buffer, int size, int lag, Out *correlation) {
+    Cascade<Tile> cascade;
+    AccumulateBlocks<Tile>(buffer, size, lag, [&](const float *sums) {
+        cascade.Add(sums);
+    });
+
+    float sums[Tile];
+    cascade.Finish(sums);
+    std::copy(sums, sums + Tile, correlation + lag);
+}
+
+template <int Tile, typename Out>
+void CorrelateTileMixed(const float *buffer, int size, int lag, Out *correlation) {
+    double totals[Tile] = {};
+    AccumulateBlocks<Tile>(buffer, size, lag, [&](const float *sums) {
+        for (int k = 0; k < Tile; ++k) {
+            totals[k] += sums[k];
+        }
+    });
+
+    for (int k = 0; k < Tile; ++k) {
+        correlation[lag + k] = (Out)totals[k];
+    }
+}
+
+// Lanes like AccumulateLanes, each with its own compensation term
+template <int Tile, typename Out>
+void CorrelateTileKahan(const float *buffer, int size, int lag, Out *correlation) {
+    constexpr int kLanes = kCorrelationLanes;
+
+    float sums[Tile][kLanes] = {};
+    float compensations[Tile][kLanes] = {};
+    int end = size - lag - (Tile - 1);
+    int i = 0;
+    for (; i + kLanes <= end; i += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+            float x = buffer[i + l];
+            for (int k = 0; k < Tile; ++k) {
+                KahanAdd(sums[k][l], compensations[k][l], x * buffer[i + lag + k + l]);
+            }
+        }
+    }
+
+    for (int k = 0; k < Tile; ++k) {
+        float sum = 0.0f;
+        float compensation = 0.0f;
+        for (int l = 0; l < kLanes; ++l) {
+            KahanAdd(sum, compensation, sums[k][l]);
+            KahanAdd(sum, compensation, -compensations[k][l]);
+        }
+        for (int j = i; j < size - lag - k; ++j) {
+            KahanAdd(sum, compensation, buffer[j] * buffer[j + lag + k]);
+        }
+        correlation[lag + k] = (Out)sum - (Out)compensation;
+    }
+}
+
+// Quantizes the whole buffer into samples for one scale across every lag
+void CorrelateQuantized(const float *buffer, int size, int beginLag, int endLag, int16_t *samples,
+    float *correlation) {
+    int shift = Tuner::Quantize(buffer, size, samples);
+    Tuner::CorrelateFixedPoint(samples, size, beginLag, endLag, std::ldexp(1.0f, -2 * shift), correlation);
+}
+
+// Quantized a chunk at a time, each with its own scale, so the energy needs
+// no workspace
+double SumSquaresQuantized(const float *buffer, int size) {
+    constexpr int kChunk = 4 * Tuner::kFixedBlock;
+
+    int16_t samples[kChunk];
+    double total = 0.0;
+    for (int begin = 0; begin < size; begin += kChunk) {
+        int count = std::min(kChunk, size - begin);
+        int shift = Tuner::Quantize(buffer + begin, count, samples);
+        total += std::ldexp((double)Tuner::SumSquaresFixed(samples, count), -2 * shift);
+    }
+    return total;
+}
+
+// The float modes, into correlation of either type
+template <typename Out>
+void CorrelateModes(const float *buffer, int size, int beginLag, int endLag, Out *correlation,
+    Tuner::Accumulation accumulation) {
+    using Tuner::Accumulation;
+    switch (accumulation) {
+        case Accumulation::Float:
+            ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+                CorrelateTileFloat<decltype(tile)::value>(buffer, size, lag, correlation);
+            });
+            break;
+        case Accumulation::Pairwise:
+            ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+                CorrelateTilePairwise<decltype(tile)::value>(buffer, size, lag, correlation);
+            });
+            break;
+        case Accumulation::Kahan:
+            ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+                CorrelateTileKahan<decltype(tile)::value>(buffer, size, lag, correlation);
+            });
+            break;
+        case Accumulation::Double:
+            ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+                CorrelateTileDouble<decltype(tile)::value>(buffer, size, lag, correlation);
+            });
+            break;
+        case Accumulation::Mixed:
+            ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+                CorrelateTileMixed<decltype(tile)::value>(buffer, size, lag, correlation);
+            });
+            break;
+        case Accumulation::FixedPoint:
+            // Quantized by the callers, it has no tiles
+            break;
+    }
+}
+
+} // namespace
+
+void Tuner::Correlate(const float *buffer, int size, int beginLag, int endLag, float *correlation,
+    Accumulation accumulation, int16_t *scratch) {
+    if (accumulation == Accumulation::FixedPoint) {
+        if (scratch) {
+            CorrelateQuantized(buffer, size, beginLag, endLag, scratch, correlation);
+            return;
+        }
+        accumulation = Accumulation::Float;
+    }
+    CorrelateModes(buffer, size, beginLag, endLag, correlation, accumulation);
+}
+
+int Tuner::FindCorrelationPeak(const float *buffer, int size, int beginLag, int endLag) {
+    int best = 0;
+    float max = 0.0f;
+    ForEachTile<kTile>(beginLag, endLag, [&](auto tile, int lag) {
+        constexpr int Tile = decltype(tile)::value;
+        float sums[Tile] = {};
+        FinishTile<Tile>(buffer, size, lag, sums);
+        for (int k = 0; k < Tile; ++k) {
+            if (sums[k] > max) {
+                max = sums[k];
+                best = lag + k;
+            }
+        }
+    });
+    return best;
+}
+
+double Tuner::SumSquares(const float *buffer, int size, Accumulation accumulation) {
+    if (accumulation == Accumulation::FixedPoint) {
+        return SumSquaresQuantized(buffer, size);
+    }
+
+    // The correlation at lag 0, in double for the modes that sum in it
+    double sum = 0.0;
+    CorrelateModes(buffer, size, 0, 1, &sum, accumulation);
+    return sum;
+}
+
+const std::vector<Tuner::AccumulationInfo>& Tuner::GetAccumulationModes() {
+    static const std::vector<AccumulationInfo> modes = {
+        {Accumulation::Float, "Float"},
+        {Accumulation::Mixed, "Mixed"},
+        {Accumulation::Pairwise, "Pairwise"},
+        {Accumulation::Kahan, "Kahan"},
+        {Accumulation::Double, "Double"},
+        {Accumulation::FixedPoint, "Int16"},
+    };
+    return modes;
+}
+
+const Tuner::AccumulationInfo& Tuner::GetAccumulationInfo(Accumulation accumulation) {
+    const auto& modes = GetAccumulationModes();
+    for (const auto& info : modes) {
+        if (info.accumulation == accumulation) {
+            return info;
+        }
+    }
+    return modes.front();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PitchDetector.hpp"
+
+namespace Tuner {
+
+// Fills correlation[lag] = sum of buffer[i] * buffer[i + lag] for every lag
+// in [beginLag, endLag) and leaves the rest alone. Accumulation::FixedPoint
+// quantizes the block into scratch, size samples, and runs in float when
+// there is none. The detectors keep a FixedPointFrame instead.
+void Correlate(const float *buffer, int size, int beginLag, int endLag, float *correlation,
+    Accumulation accumulation = Accumulation::Float, int16_t *scratch = nullptr);
+
+// Lag in [beginLag, endLag) of the largest Accumulation::Float correlation,
+// the first one on ties and 0 when none is above 0. Keeps one tile of lags
+// at a time instead of the whole correlation.
+int FindCorrelationPeak(const float *buffer, int size, int beginLag, int endLag);
+
+// Sum of buffer[i] squared, the energy RMS and normalization are based on.
+// Returned in double so the modes that sum in double keep their bits.
+double SumSquares(const float *buffer, int size, Accumulation accumulation = Accumulation::Float);
+
+struct AccumulationInfo {
+    Accumulation accumulation;
+    const char *name;
+};
+
+// All accumulation modes, the float ones fastest first, then fixed point
+const std::vector<AccumulationInfo>& GetAccumulationModes();
+const AccumulationInfo& GetAccumulationInfo(Accumulation accumulation);
+
+} // namespace Tuner
@@ -0,0 +1,73 @@
+#include "Fft.hpp"
+
+#include <cmath>
+#include <utility>
+
+void Tuner::Fft::Prepare(int size) {
+    mSize = size;
+    mBitReverse.resize(size);
+    mTwiddles.resize(size / 2);
+
+    int bits = 0;
+    while ((1 << bits) < size) {
+        ++bits;
+    }
+
+    for (int i = 0; i < size; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        mBitReverse[i] = reversed;
+    }
+
+    const double pi = 3.14159265358979323846;
+    for (int i = 0; i < size / 2; ++i) {
+        double angle = -2.0 * pi * i / size;
+        mTwiddles[i] = std::complex<float>((float)cos(angle), (float)sin(angle));
+    }
+}
+
+void Tuner::Fft::Forward(std::complex<float> *data) const {
+    Transform(data, false);
+}
+
+void Tuner::Fft::Inverse(std::complex<float> *data) const {
+    Transform(data, true);
+}
+
+void Tuner::Fft::Transform(std::complex<float> *data, bool inverse) const {
+    for (int i = 0; i < mSize; ++i) {
+        int j = mBitReverse[i];
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (int length = 2; length <= mSize; length <<= 1) {
+        int half = length / 2;
+        int stride = mSize / length;
+
+        for (int start = 0; start < mSize; start += length) {
+            for (int k = 0; k < half; ++k) {
+                std::complex<float> w = mTwiddles[k * stride];
+                if (inverse) {
+                    w = std::conj(w);
+                }
+
+                std::complex<float> even = data[start + k];
+                std::complex<float> odd = data[start + k + half] * w;
+                data[start + k] = even + odd;
+                data[start + k + half] = even - odd;
+            }
+        }
+    }
+}
+
+int Tuner::NextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
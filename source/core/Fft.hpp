@@ -0,0 +1,33 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+namespace Tuner {
+
+// Iterative radix-2 FFT with precomputed twiddles, sized once in Prepare
+class Fft {
+public:
+    // Size must be a power of two
+    void Prepare(int size);
+
+    void Forward(std::complex<float> *data) const;
+    // Unscaled, divide by GetSize() to get the original signal back
+    void Inverse(std::complex<float> *data) const;
+
+    inline int GetSize() const {
+        return mSize;
+    }
+
+private:
+    int mSize = 0;
+    std::vector<int> mBitReverse;
+    std::vector<std::complex<float>> mTwiddles;
+
+    void Transform(std::complex<float> *data, bool inverse) const;
+};
+
+// Smallest power of two that is >= value
+int NextPowerOfTwo(int value);
+
+} // namespace Tuner
@@ -0,0 +1,224 @@
+#include "FixedPoint.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Keeps quiet input from scaling past what float holds after squaring
+constexpr int kMaxShift = 60;
+// Lags the correlation runs together, 8 spill on x86-64 SSE2
+constexpr int kFixedTile = 4;
+
+// Sum of a[i] * b[i] in int32 blocks short enough not to overflow. The
+// plain loop over int16 is the pattern compilers turn into widening
+// multiply-accumulates.
+inline int64_t DotFixed(const int16_t *a, const int16_t *b, int count) {
+    int64_t total = 0;
+    for (int begin = 0; begin < count; begin += Tuner::kFixedBlock) {
+        int end = std::min(begin + Tuner::kFixedBlock, count);
+        int32_t sum = 0;
+        for (int i = begin; i < end; ++i) {
+            sum += a[i] * b[i];
+        }
+        total += sum;
+    }
+    return total;
+}
+
+} // namespace
+
+void Tuner::ConvertInt16(const int16_t *in, int count, float *out) {
+    for (int i = 0; i < count; ++i) {
+        out[i] = in[i] * (1.0f / 32768.0f);
+    }
+}
+
+void Tuner::ConvertInt24(const uint8_t *in, int count, float *out) {
+    for (int i = 0; i < count; ++i) {
+        const uint8_t *b = in + 3 * i;
+        // Into the top of an int32 and back down, which sign extends
+        int32_t value = (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24) >> 8;
+        out[i] = value * (1.0f / 8388608.0f);
+    }
+}
+
+int Tuner::Quantize(const float *in, int count, int16_t *out) {
+    float peak = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        peak = std::max(peak, std::fabs(in[i]));
+    }
+    if (!(peak > 0.0f) || !std::isfinite(peak)) {
+        std::fill(out, out + count, (int16_t)0);
+        return 0;
+    }
+
+    // peak * 2^shift just under 2^12, one less if it would round up to it
+    int exponent = 0;
+    std::frexp(peak, &exponent);
+    int shift = std::min(12 - exponent, kMaxShift);
+    if (std::ldexp(peak, shift) >= kFixedPeak + 0.5f) {
+        --shift;
+    }
+
+    // Rounds half away from zero, unlike lrint this vectorizes
+    float scale = std::ldexp(1.0f, shift);
+    for (int i = 0; i < count; ++i) {
+        float value = in[i] * scale;
+        out[i] = (int16_t)(int)(value + (value < 0.0f ? -0.5f : 0.5f));
+    }
+    return shift;
+}
+
+int Tuner::Quantize(const int16_t *in, int count, int16_t *out) {
+    int peak = 0;
+    for (int i = 0; i < count; ++i) {
+        peak = std::max(peak, std::abs((int)in[i]));
+    }
+    if (peak == 0) {
+        std::fill(out, out + count, (int16_t)0);
+        return 0;
+    }
+
+    // The float version's shift for peak / 32768, which has the exponent
+    // bits - 15. out = in * 2^(shift - 15), left shifts are exact.
+    int bits = 0;
+    while ((peak >> bits) != 0) {
+        ++bits;
+    }
+    int shift = 27 - bits;
+    int right = bits - 12;
+    if (right > 0 && 2 * peak >= (2 * kFixedPeak + 1) << right) {
+        ++right;
+        --shift;
+    }
+
+    if (right <= 0) {
+        for (int i = 0; i < count; ++i) {
+            out[i] = (int16_t)(in[i] * (1 << -right));
+        }
+        return shift;
+    }
+    // Rounds half away from zero like the float version
+    int half = 1 << (right - 1);
+    for (int i = 0; i < count; ++i) {
+        int value = in[i];
+        int magnitude = (std::abs(value) + half) >> right;
+        out[i] = (int16_t)(value < 0 ? -magnitude : magnitude);
+    }
+    return shift;
+}
+
+void Tuner::Dequantize(const int16_t *in, int count, int shift, float *out) {
+    float scale = std::ldexp(1.0f, -shift);
+    for (int i = 0; i < count; ++i) {
+        out[i] = in[i] * scale;
+    }
+}
+
+int64_t Tuner::SumSquaresFixed(const int16_t *samples, int count) {
+    return DotFixed(samples, samples, count);
+}
+
+namespace {
+
+// The Tile lags from lag on in one pass over the samples. Each lag keeps
+// its own int32 sum per kFixedBlock samples, which compilers vectorize as
+// Tile widening dot products sharing every load of samples[j]. Spreading
+// each lag over lanes instead keeps them from using pmaddwd and is slower.
+template <int Tile>
+void CorrelateTileFixed(const int16_t *samples, int size, int lag, float scale, float *correlation) {
+    const int16_t *shifted = samples + lag;
+
+    int64_t totals[Tile] = {};
+    // Terms every lag of the tile has
+    int end = size - lag - (Tile - 1);
+    for (int begin = 0; begin < end; begin += Tuner::kFixedBlock) {
+        int blockEnd = std::min(begin + Tuner::kFixedBlock, end);
+        int32_t sums[Tile] = {};
+        for (int j = begin; j < blockEnd; ++j) {
+            int32_t x = samples[j];
+            for (int k = 0; k < Tile; ++k) {
+                sums[k] += x * shifted[j + k];
+            }
+        }
+        for (int k = 0; k < Tile; ++k) {
+            totals[k] += sums[k];
+        }
+    }
+
+    // Then the ones only shorter lags have
+    for (int k = 0; k < Tile; ++k) {
+        for (int j = std::max(end, 0); j < size - lag - k; ++j) {
+            totals[k] += samples[j] * shifted[j + k];
+        }
+        correlation[lag + k] = (float)totals[k] * scale;
+    }
+}
+
+} // namespace
+
+void Tuner::CorrelateFixedPoint(const int16_t *samples, int size, int beginLag, int endLag, float scale,
+    float *correlation) {
+    int lag = beginLag;
+    for (; lag + kFixedTile <= endLag; lag += kFixedTile) {
+        CorrelateTileFixed<kFixedTile>(samples, size, lag, scale, correlation);
+    }
+    for (; lag < endLag; ++lag) {
+        CorrelateTileFixed<1>(samples, size, lag, scale, correlation);
+    }
+}
+
+int Tuner::DecimateFixed(const int16_t *in, int count, int16_t *out) {
+    constexpr int kTaps = 2 * kDecimatorDelay + 1;
+    if (count < kTaps) return 0;
+
+    int outputs = (count - kTaps) / 2 + 1;
+    for (int j = 0; j < outputs; ++j) {
+        const int16_t *center = in + 2 * j + kDecimatorDelay;
+        int32_t sum = Tuner::kHalfBandCenter * center[0];
+        for (int t = 0; t < Tuner::kHalfBandTapCount; ++t) {
+            int offset = 2 * t + 1;
+            sum += Tuner::kHalfBandTaps[t] * (center[-offset] + center[offset]);
+        }
+        // The filter overshoots a little, clamped to keep the products of
+        // the output inside the correlation headroom
+        out[j] = (int16_t)std::clamp((sum + (1 << 14)) >> 15, -kFixedPeak, kFixedPeak);
+    }
+    return outputs;
+}
+
+// Fixed-point frame
+
+void Tuner::FixedPointFrame::Prepare(float sampleRate, int maxBlock) {
+    mStep = sampleRate >= kMinDecimatedRate ? 2 : 1;
+    mSampleRate = sampleRate / mStep;
+    mQuantized.assign(maxBlock, 0);
+    mDecimated.assign(mStep > 1 ? maxBlock / 2 : 0, 0);
+    mBuffer.assign(maxBlock, 0.0f);
+    mSamples = mQuantized.data();
+    mSize = 0;
+    mShift = 0;
+}
+
+void Tuner::FixedPointFrame::Load(const float *buffer, int size) {
+    mShift = Quantize(buffer, size, mQuantized.data());
+    Decimate(size);
+}
+
+void Tuner::FixedPointFrame::Load(const int16_t *samples, int size) {
+    mShift = Quantize(samples, size, mQuantized.data());
+    Decimate(size);
+}
+
+void Tuner::FixedPointFrame::Decimate(int size) {
+    if (mStep > 1) {
+        mSize = DecimateFixed(mQuantized.data(), size, mDecimated.data());
+        mSamples = mDecimated.data();
+    } else {
+        mSize = size;
+        mSamples = mQuantized.data();
+    }
+    Dequantize(mSamples, mSize, mShift, mBuffer.data());
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Tuner {
+
+// Integer kernels for devices where float math is slow. A window is first
+// scaled by a power of two so its peak lands just under kFixedPeak and
+// rounded to int16 (block floating point). With that headroom a product
+// fits in 24 bits, so kFixedBlock of them add up in int32 lanes, which
+// compilers map to widening multiply-accumulates (pmaddwd on x86, smlal on
+// ARM), before being flushed to int64.
+constexpr int kFixedPeak = 4095;
+constexpr int kFixedBlock = 128;
+
+// Readings of the fixed-point detectors stay within this many cents of the
+// float ones on the bench corpus, darktuna_bench --accuracy checks it
+constexpr float kFixedPointCentsBound = 0.5f;
+// Lowest rate the fixed-point detectors halve, the half-band filter leaves
+// 0.3 of the output rate flat and the period picker looks up to 5 kHz
+constexpr float kMinDecimatedRate = 32000.0f;
+
+// Quantized and, at kMinDecimatedRate and up, decimated copy of a window,
+// what the fixed-point detectors analyze. Prepare allocates, Load doesn't.
+class FixedPointFrame {
+public:
+    void Prepare(float sampleRate, int maxBlock);
+    void Load(const float *buffer, int size);
+    // From captured 16 bit samples, the same frame Load gives for them
+    // converted to float, without going through float
+    void Load(const int16_t *samples, int size);
+
+    inline const int16_t* GetSamples() const {
+        return mSamples;
+    }
+
+    // The same samples in float, for what the detectors still do in float
+    inline const float* GetBuffer() const {
+        return mBuffer.data();
+    }
+
+    inline int GetSize() const {
+        return mSize;
+    }
+
+    inline float GetSampleRate() const {
+        return mSampleRate;
+    }
+
+    // Input samples per frame sample
+    inline int GetStep() const {
+        return mStep;
+    }
+
+    // Brings sums of products of the samples back to the input's scale
+    inline float GetProductScale() const {
+        return std::ldexp(1.0f, -2 * mShift);
+    }
+
+private:
+    float mSampleRate = 0.0f;
+    int mStep = 1;
+    std::vector<int16_t> mQuantized;
+    std::vector<int16_t> mDecimated;
+    std::vector<float> mBuffer;
+    const int16_t *mSamples = nullptr;
+    int mSize = 0;
+    int mShift = 0;
+
+    // The rest of Load once mQuantized holds the block
+    void Decimate(int size);
+};
+
+// Capture formats to float, for the float parts of the chain. 24 bit
+// samples are packed little-endian, 3 bytes each.
+void ConvertInt16(const int16_t *in, int count, float *out);
+void ConvertInt24(const uint8_t *in, int count, float *out);
+
+// Rounds in * 2^shift to out, returns shift. Silence gives zeros and 0.
+int Quantize(const float *in, int count, int16_t *out);
+// Same for 16 bit samples taken as in / 32768, in integer math only, with
+// the same result as converting them with ConvertInt16 first
+int Quantize(const int16_t *in, int count, int16_t *out);
+// The other way, out = in * 2^-shift
+void Dequantize(const int16_t *in, int count, int shift, float *out);
+
+// The kernels below expect samples within +-kFixedPeak, which Quantize and
+// DecimateFixed guarantee
+
+// Sum of the squared samples
+int64_t SumSquaresFixed(const int16_t *samples, int count);
+
+// correlation[lag] = scale * sum of samples[i] * samples[i + lag] for lags
+// in [beginLag, endLag), the sums themselves are exact
+void CorrelateFixedPoint(const int16_t *samples, int size, int beginLag, int endLag, float scale,
+    float *correlation);
+
+// Right half of a 23 tap half-band low-pass (Kaiser, beta 7) in Q15, the
+// center tap first. Flat to 0.15 of the input rate, -65 dB from 0.35 on.
+// The even taps past the center are zero and skipped.
+constexpr int kHalfBandCenter = 16384;
+constexpr int kHalfBandTaps[] = {10153, -2720, 1031, -345, 79, -6};
+constexpr int kHalfBandTapCount = sizeof(kHalfBandTaps) / sizeof(kHalfBandTaps[0]);
+
+// Halves the sample rate with a half-band low-pass. Only outputs whose taps
+// are all inside the input are written, returns how many.
+int DecimateFixed(const int16_t *in, int count, int16_t *out);
+// Delay of DecimateFixed, in input samples
+constexpr int kDecimatorDelay = 11;
+
+} // namespace Tuner
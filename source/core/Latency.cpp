@@ -0,0 +1,24 @@
+#include "Latency.hpp"
+
+#include <algorithm>
+
+void Tuner::LatencyHistory::Add(double seconds) {
+    mValues[mNext] = seconds;
+    mNext = (mNext + 1) % kSize;
+    mCount = std::min(mCount + 1, kSize);
+}
+
+void Tuner::LatencyHistory::Clear() {
+    mNext = 0;
+    mCount = 0;
+}
+
+double Tuner::LatencyHistory::GetPercentile(double p) const {
+    if (mCount == 0) return 0.0;
+
+    // The oldest entries are overwritten first, so the first mCount are valid
+    std::array<double, kSize> sorted = mValues;
+    int index = std::clamp((int)(p * (mCount - 1) + 0.5), 0, mCount - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + mCount);
+    return sorted[index];
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+
+namespace Tuner {
+
+// Where a reading was along the way, in seconds on the capture clock
+// (PortAudio stream time in the app). Zero means not reached yet.
+struct ReadingTimes {
+    // The newest sample of the analyzed window reached the ADC
+    double input = 0.0;
+    // The result was ready
+    double published = 0.0;
+    // The first frame showing it was presented
+    double presented = 0.0;
+
+    inline double GetResultLatency() const {
+        return published - input;
+    }
+
+    inline double GetDisplayLatency() const {
+        return presented - input;
+    }
+};
+
+// The last kSize latencies, for live percentiles. Adding never allocates.
+class LatencyHistory {
+public:
+    static constexpr int kSize = 256;
+
+    void Add(double seconds);
+    void Clear();
+
+    inline int GetCount() const {
+        return mCount;
+    }
+
+    inline double GetLast() const {
+        return mCount > 0 ? mValues[(mNext + kSize - 1) % kSize] : 0.0;
+    }
+
+    // p in 0..1 over what the history holds, 0 when empty
+    double GetPercentile(double p) const;
+
+private:
+    std::array<double, kSize> mValues = {};
+    int mNext = 0;
+    int mCount = 0;
+};
+
+} // namespace Tuner
@@ -0,0 +1,165 @@
+#include "NoiseGate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// How fast the floor may climb towards a louder background
+const float kFloorRiseDbPerSecond = 3.0f;
+// Where the floor starts, low enough that a note playing from the very first
+// block still opens the gate
+const float kInitialFloorDb = -70.0f;
+// Signal to floor ratios that open and close the gate, hysteresis in between
+const float kOpenSnrDb = 9.0f;
+const float kCloseSnrDb = 5.0f;
+// Jump over the recent level that counts as a pluck
+const float kOnsetDb = 6.0f;
+const float kOnsetSmoothing = 0.05f;
+// Above this the block is noise-like rather than tonal
+const float kMaxFlatness = 0.3f;
+const float kHoldTime = 0.15f;
+
+// Band the flatness is measured in, covers guitar fundamentals and harmonics
+const float kFlatnessLowHz = 40.0f;
+const float kFlatnessHighHz = 5000.0f;
+
+float DbToPower(float db) {
+    return powf(10.0f, db / 10.0f);
+}
+
+} // namespace
+
+void Tuner::NoiseGate::Prepare(float sampleRate, int maxBlock) {
+    mSampleRate = sampleRate;
+    mBlockSize = NextPowerOfTwo(maxBlock);
+
+    mFft.Prepare(mBlockSize);
+    mSpectrum.assign(mBlockSize, 0.0f);
+    mPending.assign(mBlockSize, 0.0f);
+    mPendingCount = 0;
+
+    const float pi = 3.14159265f;
+    mWindow.resize(mBlockSize);
+    for (int i = 0; i < mBlockSize; ++i) {
+        mWindow[i] = 0.5f - 0.5f * cosf(2.0f * pi * i / mBlockSize);
+    }
+
+    float binHz = sampleRate / mBlockSize;
+    mLowBin = std::max(1, (int)(kFlatnessLowHz / binHz));
+    mHighBin = std::min(mBlockSize / 2, (int)(kFlatnessHighHz / binHz));
+
+    float blockTime = mBlockSize / sampleRate;
+    mRiseFactor = DbToPower(kFloorRiseDbPerSecond * blockTime);
+    mSmoothAlpha = 1.0f - expf(-blockTime / kOnsetSmoothing);
+    mHoldBlocks = (int)ceilf(kHoldTime / blockTime);
+
+    mNoiseFloor = DbToPower(kInitialFloorDb);
+    mSmoothedEnergy = 0.0f;
+    mHoldRemaining = 0;
+    mOpen = false;
+}
+
+void Tuner::NoiseGate::Process(const float *buffer, int size) {
+    while (size > 0) {
+        if (mPendingCount == 0 && size >= mBlockSize) {
+            ProcessBlock(buffer);
+            buffer += mBlockSize;
+            size -= mBlockSize;
+            continue;
+        }
+
+        int count = std::min(mBlockSize - mPendingCount, size);
+        memcpy(mPending.data() + mPendingCount, buffer, count * sizeof(float));
+        mPendingCount += count;
+        buffer += count;
+        size -= count;
+
+        if (mPendingCount == mBlockSize) {
+            ProcessBlock(mPending.data());
+            mPendingCount = 0;
+        }
+    }
+}
+
+void Tuner::NoiseGate::ProcessBlock(const float *block) {
+    float energy = 0.0f;
+    for (int i = 0; i < mBlockSize; ++i) {
+        energy += block[i] * block[i];
+    }
+    energy = energy / mBlockSize + 1e-12f;
+
+    // Minimum tracking: follow quiet blocks down at once, creep up otherwise
+    if (energy < mNoiseFloor) {
+        mNoiseFloor = energy;
+    } else {
+        mNoiseFloor = std::min(energy, mNoiseFloor * mRiseFactor);
+    }
+
+    bool onset = mSmoothedEnergy > 0.0f && energy > mSmoothedEnergy * DbToPower(kOnsetDb);
+    mSmoothedEnergy += mSmoothAlpha * (energy - mSmoothedEnergy);
+
+    float snr = energy / mNoiseFloor;
+    float flatness = 1.0f;
+    // Only pay for the spectrum when the level alone can't rule the block out
+    if (snr > DbToPower(kCloseSnrDb) || onset) {
+        flatness = ComputeFlatness(block);
+    }
+    bool tonal = flatness < kMaxFlatness;
+
+    if (tonal && (onset || snr > DbToPower(kOpenSnrDb))) {
+        mOpen = true;
+        mHoldRemaining = mHoldBlocks;
+    } else if (!tonal || snr < DbToPower(kCloseSnrDb)) {
+        // Hold bridges short dips between plucks and flutter in the decay
+        if (mHoldRemaining > 0) {
+            --mHoldRemaining;
+        } else {
+            mOpen = false;
+        }
+    }
+
+    if (onset && tonal) {
+        mOnsetsOut.fetch_add(1, std::memory_order_relaxed);
+    }
+    mVoicedOut.store(mOpen, std::memory_order_relaxed);
+    mNoiseFloorOut.store(sqrtf(mNoiseFloor), std::memory_order_relaxed);
+    mFlatnessOut.store(flatness, std::memory_order_relaxed);
+}
+
+float Tuner::NoiseGate::ComputeFlatness(const float *block) {
+    for (int i = 0; i < mBlockSize; ++i) {
+        mSpectrum[i] = block[i] * mWindow[i];
+    }
+    mFft.Forward(mSpectrum.data());
+
+    // Geometric over arithmetic mean of the power spectrum
+    float logSum = 0.0f;
+    float sum = 0.0f;
+    for (int bin = mLowBin; bin < mHighBin; ++bin) {
+        float power = std::norm(mSpectrum[bin]) + 1e-20f;
+        logSum += logf(power);
+        sum += power;
+    }
+
+    int bins = mHighBin - mLowBin;
+    if (bins <= 0 || sum <= 0.0f) return 1.0f;
+    return expf(logSum / bins) / (sum / bins);
+}
+
+bool Tuner::NoiseGate::IsVoiced() const {
+    return mVoicedOut.load(std::memory_order_relaxed);
+}
+
+float Tuner::NoiseGate::GetNoiseFloor() const {
+    return mNoiseFloorOut.load(std::memory_order_relaxed);
+}
+
+float Tuner::NoiseGate::GetFlatness() const {
+    return mFlatnessOut.load(std::memory_order_relaxed);
+}
+
+unsigned Tuner::NoiseGate::GetOnsetCount() const {
+    return mOnsetsOut.load(std::memory_order_relaxed);
+}
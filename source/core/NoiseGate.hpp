@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <vector>
+
+#include "Fft.hpp"
+
+namespace Tuner {
+
+// Adaptive gate that decides whether there is a voiced signal worth running
+// pitch detection on. Every block updates a running noise floor (fast to
+// fall, slow to rise), a spectral flatness measure that tells tones from
+// broadband noise such as crowds and hiss, and an onset detector that opens
+// the gate on a fresh pluck before the floor catches up.
+//
+// Process runs on the audio thread, the getters are safe from the UI thread.
+class NoiseGate {
+public:
+    void Prepare(float sampleRate, int maxBlock);
+    void Process(const float *buffer, int size);
+
+    bool IsVoiced() const;
+    // RMS of the estimated background noise
+    float GetNoiseFloor() const;
+    // 0 for a pure tone, 1 for white noise
+    float GetFlatness() const;
+    // Increments on every detected onset
+    unsigned GetOnsetCount() const;
+
+private:
+    float mSampleRate = 44100.0f;
+    int mBlockSize = 0;
+
+    Fft mFft;
+    std::vector<std::complex<float>> mSpectrum;
+    std::vector<float> mWindow;
+    int mLowBin = 1;
+    int mHighBin = 1;
+
+    // Partial block carried between callbacks
+    std::vector<float> mPending;
+    int mPendingCount = 0;
+
+    // Energies are mean squares
+    float mNoiseFloor = 0.0f;
+    float mSmoothedEnergy = 0.0f;
+    float mRiseFactor = 1.0f;
+    float mSmoothAlpha = 0.0f;
+    int mHoldBlocks = 0;
+    int mHoldRemaining = 0;
+    bool mOpen = false;
+
+    std::atomic<bool> mVoicedOut{false};
+    std::atomic<float> mNoiseFloorOut{0.0f};
+    std::atomic<float> mFlatnessOut{1.0f};
+    std::atomic<unsigned> mOnsetsOut{0};
+
+    void ProcessBlock(const float *block);
+    float ComputeFlatness(const float *block);
+};
+
+} // namespace Tuner
@@ -0,0 +1,278 @@
+#include "Pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "FixedPoint.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How long a stage thread sleeps before looking at its queue again when a
+// wakeup went missing
+constexpr auto kWakeTimeout = std::chrono::milliseconds(1);
+// How often a caller waiting for the threads looks again
+constexpr auto kPollInterval = std::chrono::microseconds(100);
+
+void StoreMax(std::atomic<long long> &target, long long value) {
+    long long current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+const char* Tuner::PipelineStage::GetName() const {
+    switch (mType) {
+        case StageType::Filter: return "filter";
+        case StageType::Decimate: return "decimate";
+        case StageType::Gate: return "gate";
+        case StageType::Detect: return "detect";
+        case StageType::Track: return "track";
+        case StageType::Resolve: return "resolve";
+        case StageType::Publish: return "publish";
+    }
+    return "";
+}
+
+// Block queue
+
+void Tuner::Pipeline::BlockQueue::Prepare(int capacity) {
+    mSlots.assign(capacity, nullptr);
+    mHead.store(0, std::memory_order_relaxed);
+    mTail.store(0, std::memory_order_relaxed);
+}
+
+bool Tuner::Pipeline::BlockQueue::Push(PipelineBlock *block) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mHead.load(std::memory_order_acquire) == mSlots.size()) return false;
+
+    mSlots[tail % mSlots.size()] = block;
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+Tuner::PipelineBlock* Tuner::Pipeline::BlockQueue::Pop() {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    if (head == mTail.load(std::memory_order_acquire)) return nullptr;
+
+    PipelineBlock *block = mSlots[head % mSlots.size()];
+    mHead.store(head + 1, std::memory_order_release);
+    return block;
+}
+
+// Pipeline
+
+Tuner::Pipeline::~Pipeline() {
+    Stop();
+}
+
+void Tuner::Pipeline::AddStage(std::unique_ptr<PipelineStage> stage, StageRun run) {
+    auto entry = std::make_unique<StageEntry>();
+    entry->stage = std::move(stage);
+    entry->run = run;
+    mStages.push_back(std::move(entry));
+}
+
+void Tuner::Pipeline::Prepare(const PipelineFormat &format, int queueBlocks) {
+    Stop();
+
+    mSampleRate = format.sampleRate;
+    mMaxBlock = format.maxBlock;
+    PipelineFormat stageFormat = format;
+    int maxReadings = format.maxReadings;
+    for (auto& entry : mStages) {
+        stageFormat = entry->stage->Prepare(stageFormat);
+        maxReadings = std::max(maxReadings, stageFormat.maxReadings);
+    }
+    ResetTimings();
+
+    // A new segment wherever a stage doesn't run inline
+    mSegments.clear();
+    mSegments.push_back(std::make_unique<Segment>());
+    for (int i = 0; i < (int)mStages.size(); ++i) {
+        if (mStages[i]->run != StageRun::Inline) {
+            mSegments.back()->end = i;
+            mSegments.push_back(std::make_unique<Segment>());
+            mSegments.back()->begin = i;
+            mSegments.back()->run = mStages[i]->run;
+        }
+    }
+    mSegments.back()->end = (int)mStages.size();
+
+    // Every queue can hold every block, so passing one on never fails
+    mBlocks.assign(queueBlocks, PipelineBlock());
+    mFree.Prepare(queueBlocks);
+    for (auto& block : mBlocks) {
+        block.samples.assign(mMaxBlock, 0.0f);
+        block.native.assign(mMaxBlock, 0);
+        block.readings.assign(maxReadings, Reading());
+        mFree.Push(&block);
+    }
+    for (auto& segment : mSegments) {
+        segment->input.Prepare(queueBlocks);
+    }
+    mInFlight.store(0, std::memory_order_relaxed);
+    mDropped.store(0, std::memory_order_relaxed);
+
+    for (int i = 0; i < (int)mSegments.size(); ++i) {
+        if (mSegments[i]->run == StageRun::Thread) {
+            mSegments[i]->thread = std::thread(&Pipeline::ThreadLoop, this, i);
+        }
+    }
+}
+
+void Tuner::Pipeline::Stop() {
+    // In order, so each thread has taken everything the one before it
+    // passed on before it's told to stop
+    for (auto& segment : mSegments) {
+        if (!segment->thread.joinable()) continue;
+
+        segment->stopping.store(true, std::memory_order_release);
+        mWake.notify_all();
+        segment->thread.join();
+        segment->stopping.store(false, std::memory_order_release);
+    }
+}
+
+void Tuner::Pipeline::Clear() {
+    Stop();
+    mSegments.clear();
+    mBlocks.clear();
+    mStages.clear();
+}
+
+bool Tuner::Pipeline::Push(const float *samples, int count, double time) {
+    return Feed(samples, nullptr, count, time, false);
+}
+
+void Tuner::Pipeline::PushWaiting(const float *samples, int count, double time) {
+    Feed(samples, nullptr, count, time, true);
+}
+
+bool Tuner::Pipeline::Push(const int16_t *samples, int count, double time) {
+    return Feed(nullptr, samples, count, time, false);
+}
+
+bool Tuner::Pipeline::Feed(const float *samples, const int16_t *native, int count, double time, bool wait) {
+    bool complete = true;
+    for (int offset = 0; offset < count; offset += mMaxBlock) {
+        int blockCount = std::min(mMaxBlock, count - offset);
+
+        PipelineBlock *block = mFree.Pop();
+        while (!block && wait && !mBlocks.empty()) {
+            Pump();
+            std::this_thread::sleep_for(kPollInterval);
+            block = mFree.Pop();
+        }
+        if (!block) {
+            mDropped.fetch_add(blockCount, std::memory_order_relaxed);
+            complete = false;
+            continue;
+        }
+
+        if (native) {
+            memcpy(block->native.data(), native + offset, blockCount * sizeof(int16_t));
+            ConvertInt16(native + offset, blockCount, block->samples.data());
+        } else {
+            memcpy(block->samples.data(), samples + offset, blockCount * sizeof(float));
+        }
+        block->hasNative = native != nullptr;
+        block->count = blockCount;
+        block->time = time + offset / (double)mSampleRate;
+        block->gateOpen = true;
+        block->readingCount = 0;
+
+        mInFlight.fetch_add(1, std::memory_order_relaxed);
+        RunSegment(0, block);
+    }
+    return complete;
+}
+
+int Tuner::Pipeline::Pump() {
+    int blocks = 0;
+    for (int i = 1; i < (int)mSegments.size(); ++i) {
+        if (mSegments[i]->run != StageRun::Pump) continue;
+
+        while (PipelineBlock *block = mSegments[i]->input.Pop()) {
+            RunSegment(i, block);
+            ++blocks;
+        }
+    }
+    return blocks;
+}
+
+void Tuner::Pipeline::Flush() {
+    while (true) {
+        Pump();
+        if (mInFlight.load(std::memory_order_acquire) == 0) break;
+        std::this_thread::sleep_for(kPollInterval);
+    }
+}
+
+void Tuner::Pipeline::RunSegment(int index, PipelineBlock *block) {
+    Segment &segment = *mSegments[index];
+    for (int i = segment.begin; i < segment.end; ++i) {
+        StageEntry &entry = *mStages[i];
+
+        Clock::time_point start = Clock::now();
+        entry.stage->Process(*block);
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+        entry.blocks.fetch_add(1, std::memory_order_relaxed);
+        entry.totalNs.fetch_add(ns, std::memory_order_relaxed);
+        StoreMax(entry.maxNs, ns);
+    }
+
+    if (index + 1 < (int)mSegments.size()) {
+        mSegments[index + 1]->input.Push(block);
+        if (mSegments[index + 1]->run == StageRun::Thread) {
+            mWake.notify_all();
+        }
+    } else {
+        mInFlight.fetch_sub(1, std::memory_order_release);
+        mFree.Push(block);
+    }
+}
+
+void Tuner::Pipeline::ThreadLoop(int index) {
+    Segment &segment = *mSegments[index];
+    while (true) {
+        if (PipelineBlock *block = segment.input.Pop()) {
+            RunSegment(index, block);
+            continue;
+        }
+        // Whatever was queued before Stop is done by now
+        if (segment.stopping.load(std::memory_order_acquire)) break;
+
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWake.wait_for(lock, kWakeTimeout);
+    }
+}
+
+std::vector<Tuner::StageTiming> Tuner::Pipeline::GetTimings() const {
+    std::vector<StageTiming> timings;
+    for (const auto& entry : mStages) {
+        StageTiming timing;
+        timing.name = entry->stage->GetName();
+        timing.type = entry->stage->GetType();
+        timing.run = entry->run;
+        timing.blocks = entry->blocks.load(std::memory_order_relaxed);
+        if (timing.blocks > 0) {
+            timing.meanUs = entry->totalNs.load(std::memory_order_relaxed) / 1000.0 / timing.blocks;
+        }
+        timing.maxUs = entry->maxNs.load(std::memory_order_relaxed) / 1000.0;
+        timings.push_back(timing);
+    }
+    return timings;
+}
+
+void Tuner::Pipeline::ResetTimings() {
+    for (auto& entry : mStages) {
+        entry->blocks.store(0, std::memory_order_relaxed);
+        entry->totalNs.store(0, std::memory_order_relaxed);
+        entry->maxNs.store(0, std::memory_order_relaxed);
+    }
+}
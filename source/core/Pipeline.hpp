@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Note.hpp"
+
+namespace Tuner {
+
+// What a stage does, in the order they usually come
+enum class StageType {
+    Filter,
+    Decimate,
+    Gate,
+    Detect,
+    Track,
+    Resolve,
+    Publish,
+};
+
+// Where a stage runs, relative to the stage before it
+enum class StageRun {
+    // Right after it, in the same thread. The first stages run in Push.
+    Inline,
+    // On a thread of its own, behind a queue
+    Thread,
+    // Behind a queue, in whichever thread calls Pipeline::Pump, for a UI
+    // loop that owns the state the stage touches
+    Pump,
+};
+
+// Rate and largest block of the audio going into a stage
+struct PipelineFormat {
+    float sampleRate = 44100.0f;
+    int maxBlock = 512;
+    // Most readings a block can carry, raised by the stages that analyze
+    int maxReadings = 0;
+};
+
+// Result of one analyzed window
+struct Reading {
+    // Samples at the detector's rate up to the end of the analyzed window
+    long long sampleIndex = 0;
+    // Capture time of the newest sample in the window, on the clock of the
+    // times passed to Pipeline::Push
+    double inputTime = 0.0;
+    float rms = 0.0f;
+    bool voiced = false;
+    // Zero with a null note when nothing in range was detected
+    float frequency = 0.0f;
+    float confidence = 0.0f;
+    const Note *note = nullptr;
+    float centsOff = 0.0f;
+    // Detector the reading came from, empty when nothing was analyzed
+    const char *detector = "";
+};
+
+// A block of audio and what the stages found in it. Blocks are allocated by
+// Pipeline::Prepare and handed from stage to stage, never copied.
+struct PipelineBlock {
+    // Room for the input's maxBlock, count is what's valid
+    std::vector<float> samples;
+    int count = 0;
+    // The same samples as captured, when they were pushed as 16 bit. A
+    // stage that changes samples clears hasNative.
+    std::vector<int16_t> native;
+    bool hasNative = false;
+    // Capture time of samples[0]
+    double time = 0.0;
+    // Left set when there is no gate
+    bool gateOpen = true;
+    // One reading per window that ended in this block, oldest first, in
+    // room for the format's maxReadings
+    std::vector<Reading> readings;
+    int readingCount = 0;
+};
+
+class PipelineStage {
+public:
+    explicit PipelineStage(StageType type) : mType(type) {}
+    virtual ~PipelineStage() = default;
+
+    // Takes the format of the blocks coming in and returns the one going
+    // out. Allocates here, Process must not.
+    virtual PipelineFormat Prepare(const PipelineFormat &format) {
+        return format;
+    }
+    virtual void Process(PipelineBlock &block) = 0;
+
+    inline StageType GetType() const {
+        return mType;
+    }
+
+    virtual const char* GetName() const;
+
+private:
+    StageType mType;
+};
+
+// Time a stage spent in Process
+struct StageTiming {
+    const char *name = "";
+    StageType type = StageType::Filter;
+    StageRun run = StageRun::Inline;
+    long long blocks = 0;
+    double meanUs = 0.0;
+    double maxUs = 0.0;
+};
+
+// Stages in a row, cut into segments wherever one doesn't run inline. Each
+// segment is fed by a single producer single consumer queue, and a fixed
+// set of blocks goes round from Push through every segment and back, so
+// nothing is allocated after Prepare. Push never waits: without a free
+// block the input is dropped, which keeps it usable on an audio thread as
+// long as the stages before the first queue are.
+class Pipeline {
+public:
+    Pipeline() = default;
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // Stages run in the order they were added. Returns the stage, which
+    // the pipeline owns.
+    template <typename Stage>
+    Stage& Add(std::unique_ptr<Stage> stage, StageRun run = StageRun::Inline) {
+        Stage &added = *stage;
+        AddStage(std::move(stage), run);
+        return added;
+    }
+
+    // Stops the threads, prepares every stage, allocates the blocks and
+    // starts the threads again. queueBlocks bounds how far the segments
+    // may run apart.
+    void Prepare(const PipelineFormat &format, int queueBlocks = 16);
+    // Lets the threads finish what they hold and joins them
+    void Stop();
+    // Stops and removes every stage, for assembling a different pipeline
+    void Clear();
+
+    // Feeds count samples of any length, time is when samples[0] was
+    // captured. Returns false when some were dropped for lack of blocks.
+    bool Push(const float *samples, int count, double time = 0.0);
+    // Same, but waits for blocks instead of dropping, pumping meanwhile.
+    // For offline input that has all the time it needs.
+    void PushWaiting(const float *samples, int count, double time = 0.0);
+    // 16 bit capture, converted for the float stages and kept as it is for
+    // the fixed-point detectors
+    bool Push(const int16_t *samples, int count, double time = 0.0);
+    // Runs the Pump stages on what reached them, returns the block count
+    int Pump();
+    // Waits until every pushed block went all the way through, pumping
+    // meanwhile. Call it from the thread that pumps.
+    void Flush();
+
+    std::vector<StageTiming> GetTimings() const;
+    void ResetTimings();
+
+    inline long long GetDroppedSamples() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+    inline int GetStageCount() const {
+        return (int)mStages.size();
+    }
+
+private:
+    // Fixed capacity ring of blocks, one thread pushes and one pops
+    class BlockQueue {
+    public:
+        void Prepare(int capacity);
+        bool Push(PipelineBlock *block);
+        PipelineBlock* Pop();
+
+    private:
+        std::vector<PipelineBlock*> mSlots;
+        std::atomic<size_t> mHead{0};
+        std::atomic<size_t> mTail{0};
+    };
+
+    struct StageEntry {
+        std::unique_ptr<PipelineStage> stage;
+        StageRun run = StageRun::Inline;
+        std::atomic<long long> blocks{0};
+        std::atomic<long long> totalNs{0};
+        std::atomic<long long> maxNs{0};
+    };
+
+    // Stages [begin, end) and the queue in front of them, the first
+    // segment has none and runs in Push
+    struct Segment {
+        int begin = 0;
+        int end = 0;
+        StageRun run = StageRun::Inline;
+        BlockQueue input;
+        std::thread thread;
+        std::atomic<bool> stopping{false};
+    };
+
+    std::vector<std::unique_ptr<StageEntry>> mStages;
+    std::vector<std::unique_ptr<Segment>> mSegments;
+    std::vector<PipelineBlock> mBlocks;
+    // Blocks back from the last segment, for Push
+    BlockQueue mFree;
+
+    float mSampleRate = 0.0f;
+    int mMaxBlock = 0;
+    std::atomic<int> mInFlight{0};
+    std::atomic<long long> mDropped{0};
+
+    // Threads sleep on this between blocks. Push notifies without taking
+    // the mutex and the waits time out, so a missed wakeup costs at most
+    // one timeout instead of a lock on the audio thread.
+    std::mutex mWakeMutex;
+    std::condition_variable mWake;
+
+    void AddStage(std::unique_ptr<PipelineStage> stage, StageRun run);
+    // One of samples and native, the other is null
+    bool Feed(const float *samples, const int16_t *native, int count, double time, bool wait);
+    // Runs a segment's stages on block and passes it on
+    void RunSegment(int index, PipelineBlock *block);
+    void ThreadLoop(int index);
+};
+
+} // namespace Tuner
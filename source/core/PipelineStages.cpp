@@ -0,0 +1,247 @@
+#include "PipelineStages.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Correlation.hpp"
+#include "FixedPoint.hpp"
+#include "Tuner.hpp"
+
+// Filter
+
+Tuner::FilterStage::FilterStage(const PreFilterConfig &config) : PipelineStage(StageType::Filter) {
+    mPreFilter.SetConfig(config);
+}
+
+Tuner::PipelineFormat Tuner::FilterStage::Prepare(const PipelineFormat &format) {
+    mPreFilter.Prepare(format.sampleRate);
+    return format;
+}
+
+void Tuner::FilterStage::Process(PipelineBlock &block) {
+    mPreFilter.Process(block.samples.data(), block.count);
+    // Without sections, after Process applied the config, it passes them
+    // through untouched
+    if (mPreFilter.GetNumSections() > 0) {
+        block.hasNative = false;
+    }
+}
+
+// Decimate
+
+Tuner::DecimateStage::DecimateStage() : PipelineStage(StageType::Decimate) {
+    mCenterTap = kHalfBandCenter / 32768.0f;
+    for (int t = 0; t < kHalfBandTapCount; ++t) {
+        mTaps.push_back(kHalfBandTaps[t] / 32768.0f);
+    }
+}
+
+Tuner::PipelineFormat Tuner::DecimateStage::Prepare(const PipelineFormat &format) {
+    mSampleRate = format.sampleRate;
+    mBuffer.assign(2 * kDecimatorDelay + format.maxBlock, 0.0f);
+    mNext = kDecimatorDelay;
+
+    PipelineFormat out = format;
+    out.sampleRate = format.sampleRate / 2.0f;
+    out.maxBlock = (format.maxBlock + 1) / 2;
+    return out;
+}
+
+void Tuner::DecimateStage::Process(PipelineBlock &block) {
+    constexpr int kHistory = 2 * kDecimatorDelay;
+    memcpy(mBuffer.data() + kHistory, block.samples.data(), block.count * sizeof(float));
+    int end = kHistory + block.count;
+
+    // Outputs go back into the block, which is read from mBuffer
+    int outputs = 0;
+    double time = block.time + (mNext - kHistory) / (double)mSampleRate;
+    for (; mNext + kDecimatorDelay < end; mNext += 2) {
+        const float *center = mBuffer.data() + mNext;
+        float sum = mCenterTap * center[0];
+        for (int t = 0; t < kHalfBandTapCount; ++t) {
+            int offset = 2 * t + 1;
+            sum += mTaps[t] * (center[-offset] + center[offset]);
+        }
+        block.samples[outputs++] = sum;
+    }
+
+    memmove(mBuffer.data(), mBuffer.data() + block.count, kHistory * sizeof(float));
+    mNext -= block.count;
+    block.count = outputs;
+    block.time = time;
+    block.hasNative = false;
+}
+
+// Gate
+
+Tuner::GateStage::GateStage() : PipelineStage(StageType::Gate) {
+}
+
+Tuner::PipelineFormat Tuner::GateStage::Prepare(const PipelineFormat &format) {
+    mNoiseGate.Prepare(format.sampleRate, format.maxBlock);
+    return format;
+}
+
+void Tuner::GateStage::Process(PipelineBlock &block) {
+    mNoiseGate.Process(block.samples.data(), block.count);
+    block.gateOpen = mNoiseGate.IsVoiced();
+}
+
+// Detect
+
+Tuner::DetectStage::DetectStage(const DetectConfig &config) : PipelineStage(StageType::Detect), mConfig(config) {
+}
+
+Tuner::PipelineFormat Tuner::DetectStage::Prepare(const PipelineFormat &format) {
+    mSampleRate = format.sampleRate;
+    SetDetector(mConfig.detector);
+
+    mHistory.assign(mConfig.windowSize, 0.0f);
+    mWindow.assign(mConfig.windowSize, 0.0f);
+    mNativeHistory.assign(mConfig.windowSize, 0);
+    mNativeWindow.assign(mConfig.windowSize, 0);
+    mNativeCount = 0;
+    mHistoryIndex = 0;
+    mSinceAnalysis = 0;
+    mSampleCount = 0;
+
+    // Windows end a hop apart, a block can take in that many of them
+    PipelineFormat out = format;
+    out.maxReadings = std::max(format.maxReadings, (format.maxBlock + mConfig.hopSize - 1) / mConfig.hopSize);
+    return out;
+}
+
+void Tuner::DetectStage::SetDetector(DetectorType type) {
+    mConfig.detector = type;
+    // Created in Prepare when that hasn't run yet
+    if (mSampleRate <= 0.0f) return;
+
+    mDetector = CreateDetector(type);
+    mDetector->Prepare(mSampleRate, mConfig.windowSize);
+    mDetector->SetAccumulation(mConfig.accumulation);
+}
+
+void Tuner::DetectStage::SetAccumulation(Accumulation accumulation) {
+    mConfig.accumulation = accumulation;
+    if (mDetector) {
+        mDetector->SetAccumulation(accumulation);
+    }
+}
+
+void Tuner::DetectStage::SetGate(bool adaptive, float rmsThreshold) {
+    mConfig.adaptiveGate = adaptive;
+    mConfig.rmsThreshold = rmsThreshold;
+}
+
+void Tuner::DetectStage::Process(PipelineBlock &block) {
+    int windowSize = mConfig.windowSize;
+    for (int i = 0; i < block.count; ++i) {
+        mHistory[mHistoryIndex] = block.samples[i];
+        if (block.hasNative) {
+            mNativeHistory[mHistoryIndex] = block.native[i];
+            mNativeCount = std::min(mNativeCount + 1, windowSize);
+        } else {
+            mNativeCount = 0;
+        }
+        if (++mHistoryIndex == windowSize) {
+            mHistoryIndex = 0;
+        }
+        ++mSampleCount;
+
+        // Only analyze once the window has been filled the first time
+        if (++mSinceAnalysis >= mConfig.hopSize && mSampleCount >= windowSize) {
+            mSinceAnalysis = 0;
+            Analyze(block, block.time + i / (double)mSampleRate);
+        }
+    }
+}
+
+void Tuner::DetectStage::Analyze(PipelineBlock &block, double inputTime) {
+    int windowSize = mConfig.windowSize;
+
+    // Unroll the ring buffer, oldest sample first
+    int tail = windowSize - mHistoryIndex;
+    memcpy(mWindow.data(), mHistory.data() + mHistoryIndex, tail * sizeof(float));
+    memcpy(mWindow.data() + tail, mHistory.data(), mHistoryIndex * sizeof(float));
+
+    float sum = (float)SumSquares(mWindow.data(), windowSize, mConfig.accumulation);
+
+    Reading &reading = block.readings[block.readingCount++];
+    reading = Reading();
+    reading.sampleIndex = mSampleCount;
+    reading.inputTime = inputTime;
+    reading.rms = sqrtf(sum / windowSize);
+    reading.voiced = mConfig.adaptiveGate ? block.gateOpen : reading.rms > mConfig.rmsThreshold;
+    if (!reading.voiced) return;
+
+    // The fixed-point detectors take the captured samples when the whole
+    // window came as 16 bit, instead of quantizing its conversion again
+    PitchResult pitch;
+    if (mConfig.accumulation == Accumulation::FixedPoint && mNativeCount == windowSize) {
+        memcpy(mNativeWindow.data(), mNativeHistory.data() + mHistoryIndex, tail * sizeof(int16_t));
+        memcpy(mNativeWindow.data() + tail, mNativeHistory.data(), mHistoryIndex * sizeof(int16_t));
+        pitch = mDetector->ProcessInt16(mWindow.data(), mNativeWindow.data(), windowSize);
+    } else {
+        pitch = mDetector->Process(mWindow.data(), windowSize);
+    }
+    reading.frequency = pitch.frequency;
+    reading.confidence = pitch.confidence;
+    reading.detector = GetDetectorInfo(mDetector->GetEngine()).name;
+}
+
+// Track
+
+Tuner::TrackStage::TrackStage() : PipelineStage(StageType::Track) {
+}
+
+void Tuner::TrackStage::Process(PipelineBlock &block) {
+    for (int i = 0; i < block.readingCount; ++i) {
+        Reading &reading = block.readings[i];
+        if (!(reading.frequency > kMinFrequency && reading.frequency < kMaxFrequency)) {
+            reading.frequency = 0.0f;
+            reading.confidence = 0.0f;
+        }
+    }
+}
+
+// Resolve
+
+Tuner::ResolveStage::ResolveStage() : PipelineStage(StageType::Resolve) {
+}
+
+void Tuner::ResolveStage::Process(PipelineBlock &block) {
+    for (int i = 0; i < block.readingCount; ++i) {
+        Reading &reading = block.readings[i];
+        if (reading.frequency <= 0.0f) continue;
+
+        reading.note = &GetClosestNote(reading.frequency);
+        reading.centsOff = GetCentsOff(reading.frequency, reading.note->freq);
+    }
+}
+
+// Publish
+
+Tuner::PublishStage::PublishStage(Callback callback)
+    : PipelineStage(StageType::Publish), mCallback(std::move(callback)) {
+}
+
+void Tuner::PublishStage::Process(PipelineBlock &block) {
+    for (int i = 0; i < block.readingCount; ++i) {
+        mCallback(block.readings[i]);
+    }
+}
+
+// Function
+
+Tuner::FunctionStage::FunctionStage(StageType type, const char *name, Function function)
+    : PipelineStage(type), mName(name), mFunction(std::move(function)) {
+}
+
+void Tuner::FunctionStage::Process(PipelineBlock &block) {
+    mFunction(block);
+}
+
+const char* Tuner::FunctionStage::GetName() const {
+    return mName;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "NoiseGate.hpp"
+#include "Pipeline.hpp"
+#include "PitchDetector.hpp"
+#include "PreFilter.hpp"
+
+namespace Tuner {
+
+// The stages the tuner is built from. Each one owns the state it needs and
+// allocates nothing in Process.
+
+// Pre-filter, in place
+class FilterStage : public PipelineStage {
+public:
+    explicit FilterStage(const PreFilterConfig &config = PreFilterConfig());
+
+    PipelineFormat Prepare(const PipelineFormat &format) override;
+    void Process(PipelineBlock &block) override;
+
+    // SetConfig on it is safe from any thread
+    inline PreFilter& GetPreFilter() {
+        return mPreFilter;
+    }
+
+private:
+    PreFilter mPreFilter;
+};
+
+// Halves the sample rate with the half-band low-pass of the fixed-point
+// path, in float. Block times are shifted to the samples the outputs are
+// centered on, so the filter's delay doesn't show as latency.
+class DecimateStage : public PipelineStage {
+public:
+    DecimateStage();
+
+    PipelineFormat Prepare(const PipelineFormat &format) override;
+    void Process(PipelineBlock &block) override;
+
+private:
+    float mSampleRate = 0.0f;
+    float mCenterTap = 0.5f;
+    std::vector<float> mTaps;
+    // The last 2 * kDecimatorDelay input samples, then the block
+    std::vector<float> mBuffer;
+    // Index into mBuffer of the next output's center
+    int mNext = 0;
+};
+
+// Noise gate, sets gateOpen on every block
+class GateStage : public PipelineStage {
+public:
+    GateStage();
+
+    PipelineFormat Prepare(const PipelineFormat &format) override;
+    void Process(PipelineBlock &block) override;
+
+    // The getters on it are safe from any thread
+    inline const NoiseGate& GetNoiseGate() const {
+        return mNoiseGate;
+    }
+
+private:
+    NoiseGate mNoiseGate;
+};
+
+struct DetectConfig {
+    // Samples per analysis and samples between analyses, at the rate coming
+    // into the stage
+    int windowSize = 2048;
+    int hopSize = 2048;
+    DetectorType detector = DetectorType::Auto;
+    Accumulation accumulation = Accumulation::Float;
+    // Trust the gate stage, or a fixed RMS threshold when off
+    bool adaptiveGate = true;
+    float rmsThreshold = 0.01f;
+};
+
+// Windows the audio and runs a pitch detector every hop, adding a reading
+// to the block for every window that ends in it. Readings keep the raw
+// detector output, the track and resolve stages make a note of it.
+class DetectStage : public PipelineStage {
+public:
+    explicit DetectStage(const DetectConfig &config = DetectConfig());
+
+    PipelineFormat Prepare(const PipelineFormat &format) override;
+    void Process(PipelineBlock &block) override;
+
+    // Only from the thread the stage runs on, or while the pipeline is
+    // stopped. SetDetector allocates.
+    void SetDetector(DetectorType type);
+    void SetAccumulation(Accumulation accumulation);
+    void SetGate(bool adaptive, float rmsThreshold);
+
+    inline const DetectConfig& GetConfig() const {
+        return mConfig;
+    }
+
+    inline PitchDetector* GetDetector() const {
+        return mDetector.get();
+    }
+
+    // The newest analyzed window, oldest sample first
+    inline const float* GetWindow() const {
+        return mWindow.data();
+    }
+
+private:
+    DetectConfig mConfig;
+    float mSampleRate = 0.0f;
+    std::unique_ptr<PitchDetector> mDetector;
+
+    // Ring buffer of the latest windowSize samples
+    std::vector<float> mHistory;
+    int mHistoryIndex = 0;
+    std::vector<float> mWindow;
+    // The same ring and window in 16 bit for blocks with native samples,
+    // mNativeCount of the latest samples came with them
+    std::vector<int16_t> mNativeHistory;
+    std::vector<int16_t> mNativeWindow;
+    int mNativeCount = 0;
+    int mSinceAnalysis = 0;
+    long long mSampleCount = 0;
+
+    void Analyze(PipelineBlock &block, double inputTime);
+};
+
+// Drops detections outside the tuner's range
+class TrackStage : public PipelineStage {
+public:
+    TrackStage();
+
+    void Process(PipelineBlock &block) override;
+};
+
+// Names the closest note and how far off it the reading is
+class ResolveStage : public PipelineStage {
+public:
+    ResolveStage();
+
+    void Process(PipelineBlock &block) override;
+};
+
+// Hands every reading to a callback, on the thread the stage runs on
+class PublishStage : public PipelineStage {
+public:
+    using Callback = std::function<void(const Reading&)>;
+
+    explicit PublishStage(Callback callback);
+
+    void Process(PipelineBlock &block) override;
+
+private:
+    Callback mCallback;
+};
+
+// Runs a function on every block, for taps that need the audio itself
+class FunctionStage : public PipelineStage {
+public:
+    using Function = std::function<void(PipelineBlock&)>;
+
+    FunctionStage(StageType type, const char *name, Function function);
+
+    void Process(PipelineBlock &block) override;
+    const char* GetName() const override;
+
+private:
+    const char *mName;
+    Function mFunction;
+};
+
+} // namespace Tuner
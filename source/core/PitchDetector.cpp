@@ -0,0 +1,747 @@
+#include "PitchDetector.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "Correlation.hpp"
+
+using Tuner::ParabolicOffset;
+using Tuner::PitchResult;
+
+namespace {
+
+// McLeod peak picking: skip the lobe around lag 0, take the maximum of each
+// positive lobe after it and return the first one close to the overall best.
+float PickNsdfPeak(const float *nsdf, int minLag, int maxLag, float &peak) {
+    const float kThreshold = 0.93f;
+
+    int lag = 1;
+    while (lag < maxLag && nsdf[lag] > 0.0f) {
+        ++lag;
+    }
+
+    int keyLags[64];
+    int numKeys = 0;
+    float highest = 0.0f;
+
+    while (lag < maxLag && numKeys < 64) {
+        while (lag < maxLag && nsdf[lag] <= 0.0f) {
+            ++lag;
+        }
+
+        int best = lag;
+        while (lag < maxLag && nsdf[lag] > 0.0f) {
+            if (nsdf[lag] > nsdf[best]) {
+                best = lag;
+            }
+            ++lag;
+        }
+
+        // A lobe cut off by maxLag has no real maximum
+        if (best >= minLag && lag < maxLag && nsdf[best] > 0.0f) {
+            keyLags[numKeys++] = best;
+            highest = std::max(highest, nsdf[best]);
+        }
+    }
+
+    for (int i = 0; i < numKeys; ++i) {
+        int key = keyLags[i];
+        if (nsdf[key] >= kThreshold * highest) {
+            peak = nsdf[key];
+            return key + ParabolicOffset(nsdf[key - 1], nsdf[key], nsdf[key + 1]);
+        }
+    }
+
+    peak = 0.0f;
+    return 0.0f;
+}
+
+// Turns r(tau) into the normalized square difference in place. r(0) is the
+// energy, m is kept in double so the subtractions don't eat into it.
+void NormalizeSquareDifference(const float *buffer, int size, float *correlation, int maxLag) {
+    double m = 2.0 * correlation[0];
+
+    for (int tau = 0; tau <= maxLag; ++tau) {
+        if (tau > 0) {
+            m -= (double)buffer[tau - 1] * buffer[tau - 1] + (double)buffer[size - tau] * buffer[size - tau];
+        }
+        correlation[tau] = m > 0.0 ? (float)(2.0 * correlation[tau] / m) : 0.0f;
+    }
+}
+
+// The lane-tiled correlation kernels, with the normalization and peak
+// picking that follow them, do about this many multiply-adds in the time
+// YIN's scalar loop does one (darktuna_bench detector, 512 to 8192)
+const float kCorrelationSpeedup = 4.5f;
+// Measured cost of one radix-2 butterfly in scalar multiply-adds. The
+// std::complex multiply checks for NaNs and the twiddles are strided, so
+// it is far from the 6 flops it takes on paper.
+const float kButterflyCost = 22.0f;
+
+PitchResult MakeResult(float sampleRate, float lag, float confidence) {
+    PitchResult result;
+    if (lag > 0.0f) {
+        result.frequency = sampleRate / lag;
+        result.confidence = std::clamp(confidence, 0.0f, 1.0f);
+    }
+    return result;
+}
+
+// Period picker: peaks this close to the best one count as the same period
+const float kNearBest = 0.9f;
+// How much lower a multiple's peak may be and still be considered
+const float kMultipleTolerance = 0.05f;
+// Share of energy on the lower pitch's own harmonics needed to move to it
+const float kSubharmonicRatio = 0.01f;
+// How strongly the previous reading tips that decision
+const float kPriorWeight = 4.0f;
+// Readings below this don't become the prior
+const float kPriorConfidence = 0.5f;
+// Harmonics of the candidate looked at, and the highest frequency used
+const int kHarmonics = 6;
+const float kMaxHarmonicFrequency = 5000.0f;
+const int kMaxBins = 3 * kHarmonics;
+
+// Lag range covering kMinFrequency..kMaxFrequency at a sample rate
+int GetMinLagAt(float sampleRate) {
+    return std::max(2, (int)(sampleRate / Tuner::kMaxFrequency));
+}
+
+int GetMaxLagAt(float sampleRate, int size) {
+    return std::min(size / 2, (int)ceilf(sampleRate / Tuner::kMinFrequency));
+}
+
+bool IsNearLag(float lag, float other) {
+    return other > 0.0f && fabsf(lag - other) <= 0.03f * other;
+}
+
+bool EqualsIgnoreCase(const char *a, const char *b) {
+    for (; *a && *b; ++a, ++b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+    }
+    return *a == *b;
+}
+
+} // namespace
+
+void Tuner::PitchDetector::Prepare(float sampleRate, int maxBlock) {
+    mSampleRate = sampleRate;
+    mMaxBlock = maxBlock;
+    mLagView = {};
+}
+
+int Tuner::PitchDetector::GetMinLag() const {
+    return GetMinLagAt(mSampleRate);
+}
+
+int Tuner::PitchDetector::GetMaxLag(int size) const {
+    return GetMaxLagAt(mSampleRate, size);
+}
+
+// Period picker
+
+void Tuner::PeriodPicker::Prepare(float sampleRate, int maxBlock) {
+    mSampleRate = sampleRate;
+    mNormalized.assign(maxBlock / 2 + 1, 0.0f);
+    mWindow.reserve(maxBlock);
+    mWindow.clear();
+    mNormalizedView = {};
+    mPriorLag = 0.0f;
+}
+
+void Tuner::PeriodPicker::Reset() {
+    mPriorLag = 0.0f;
+}
+
+PitchResult Tuner::PeriodPicker::Pick(const float *buffer, int size, const float *correlation, int minLag, int maxLag) {
+    Normalize(buffer, size, correlation, minLag, maxLag);
+    const float *n = mNormalized.data();
+
+    // Best local maximum, then the shortest lag that comes close to it
+    float best = 0.0f;
+    for (int lag = minLag + 1; lag < maxLag - 1; ++lag) {
+        if (n[lag] > n[lag - 1] && n[lag] >= n[lag + 1]) {
+            best = std::max(best, n[lag]);
+        }
+    }
+    if (best <= 0.0f) {
+        mPriorLag = 0.0f;
+        return {};
+    }
+
+    int lag = 0;
+    for (int l = minLag + 1; l < maxLag - 1; ++l) {
+        if (n[l] > n[l - 1] && n[l] >= n[l + 1] && n[l] >= kNearBest * best) {
+            lag = l;
+            break;
+        }
+    }
+
+    // The signal is just as periodic at 2 and 3 times the period, so only
+    // the spectrum can tell a weak fundamental from a harmonic
+    for (int multiple = 2; multiple <= 3; ++multiple) {
+        int candidate = FindPeakNear((float)(lag * multiple), minLag, maxLag);
+        if (candidate == 0 || n[candidate] < n[lag] - kMultipleTolerance) continue;
+
+        float threshold = kSubharmonicRatio;
+        if (IsNearLag((float)candidate, mPriorLag)) {
+            threshold /= kPriorWeight;
+        } else if (IsNearLag((float)lag, mPriorLag)) {
+            threshold *= kPriorWeight;
+        }
+
+        if (GetSubharmonicRatio(buffer, size, (float)lag, multiple) >= threshold) {
+            lag = candidate;
+            break;
+        }
+    }
+
+    float period = (float)lag;
+    if (lag > minLag && lag + 1 < maxLag) {
+        period += ParabolicOffset(n[lag - 1], n[lag], n[lag + 1]);
+    }
+
+    PitchResult result;
+    result.frequency = mSampleRate / period;
+    result.confidence = std::clamp(n[lag], 0.0f, 1.0f);
+    mPriorLag = result.confidence >= kPriorConfidence ? period : 0.0f;
+    return result;
+}
+
+void Tuner::PeriodPicker::Normalize(const float *buffer, int size, const float *correlation, int minLag, int maxLag) {
+    // Energy of buffer[0, size - lag) and of buffer[lag, size), in double
+    // so the running subtractions don't eat into it
+    double total = SumSquares(buffer, size, mAccumulation);
+
+    double head = total;
+    double tail = total;
+    for (int lag = 0; lag < maxLag; ++lag) {
+        if (lag >= minLag) {
+            double energy = sqrt(head * tail);
+            mNormalized[lag] = energy > 0.0 ? (float)(correlation[lag] / energy) : 0.0f;
+        }
+        head -= (double)buffer[size - lag - 1] * buffer[size - lag - 1];
+        tail -= (double)buffer[lag] * buffer[lag];
+    }
+
+    mNormalizedView = {mNormalized.data(), minLag, maxLag};
+}
+
+int Tuner::PeriodPicker::FindPeakNear(float lag, int minLag, int maxLag) const {
+    int spread = std::max(2, (int)(0.03f * lag));
+    int begin = std::max(minLag, (int)lag - spread);
+    int end = std::min(maxLag, (int)lag + spread + 1);
+    if (begin >= end) return 0;
+
+    int best = begin;
+    for (int l = begin + 1; l < end; ++l) {
+        if (mNormalized[l] > mNormalized[best]) {
+            best = l;
+        }
+    }
+    return best;
+}
+
+float Tuner::PeriodPicker::GetSubharmonicRatio(const float *buffer, int size, float lag, int multiple) {
+    float fundamental = mSampleRate / lag / multiple;
+    float limit = std::min(kMaxHarmonicFrequency, 0.45f * mSampleRate);
+
+    float frequencies[kMaxBins];
+    float powers[kMaxBins];
+    int count = 0;
+    while (count < kHarmonics * multiple && (count + 1) * fundamental < limit) {
+        frequencies[count] = (count + 1) * fundamental;
+        ++count;
+    }
+    if (count == 0) return 0.0f;
+    GetPowers(buffer, size, frequencies, count, powers);
+
+    // Every multiple-th harmonic of the lower pitch is shared with the higher one
+    float own = 0.0f;
+    float shared = 0.0f;
+    for (int k = 0; k < count; ++k) {
+        if ((k + 1) % multiple == 0) {
+            shared += powers[k];
+        } else {
+            own += powers[k];
+        }
+    }
+
+    return shared > 0.0f ? own / shared : 0.0f;
+}
+
+void Tuner::PeriodPicker::GetPowers(const float *buffer, int size, const float *frequencies, int count, float *powers) {
+    const float pi = 3.14159265f;
+
+    // Hann window, it keeps the leakage of a strong harmonic out of the
+    // bins half a harmonic away
+    if ((int)mWindow.size() != size) {
+        mWindow.resize(size);
+        for (int i = 0; i < size; ++i) {
+            mWindow[i] = 0.5f - 0.5f * cosf(2.0f * pi * i / (size - 1));
+        }
+    }
+
+    // Goertzel for all bins in one pass, the independent recurrences
+    // overlap instead of each one waiting on itself
+    float coeff[kMaxBins];
+    float s1[kMaxBins] = {};
+    float s2[kMaxBins] = {};
+    for (int k = 0; k < count; ++k) {
+        coeff[k] = 2.0f * cosf(2.0f * pi * frequencies[k] / mSampleRate);
+    }
+
+    for (int i = 0; i < size; ++i) {
+        float x = buffer[i] * mWindow[i];
+        for (int k = 0; k < count; ++k) {
+            float s = x + coeff[k] * s1[k] - s2[k];
+            s2[k] = s1[k];
+            s1[k] = s;
+        }
+    }
+
+    for (int k = 0; k < count; ++k) {
+        powers[k] = s1[k] * s1[k] + s2[k] * s2[k] - coeff[k] * s1[k] * s2[k];
+    }
+}
+
+// Autocorrelation
+
+void Tuner::AutocorrelationDetector::Prepare(float sampleRate, int maxBlock) {
+    PitchDetector::Prepare(sampleRate, maxBlock);
+    mCorrelation.assign(maxBlock / 2 + 1, 0.0f);
+    mPicker.Prepare(sampleRate, maxBlock);
+    mFrame.Prepare(sampleRate, maxBlock);
+    mFramePicker.Prepare(mFrame.GetSampleRate(), maxBlock);
+}
+
+PitchResult Tuner::AutocorrelationDetector::Process(const float *buffer, int size) {
+    if (mAccumulation == Accumulation::FixedPoint) {
+        mFrame.Load(buffer, size);
+        return ProcessFrame(size);
+    }
+
+    int minLag = GetMinLag();
+    int maxLag = GetMaxLag(size);
+
+    Correlate(buffer, size, minLag, maxLag, mCorrelation.data(), mAccumulation);
+
+    PitchResult result = mPicker.Pick(buffer, size, mCorrelation.data(), minLag, maxLag);
+    mLagView = mPicker.GetNormalized();
+    return result;
+}
+
+PitchResult Tuner::AutocorrelationDetector::ProcessInt16(const float *buffer, const int16_t *samples, int size) {
+    if (mAccumulation != Accumulation::FixedPoint) {
+        return Process(buffer, size);
+    }
+    mFrame.Load(samples, size);
+    return ProcessFrame(size);
+}
+
+PitchResult Tuner::AutocorrelationDetector::ProcessFrame(int size) {
+    int frameSize = mFrame.GetSize();
+    // The range the float path searches, from the input size since the
+    // decimator's edges cost the frame a few samples. One lag more, so a
+    // period between the last two frame lags still has a right neighbour.
+    int step = mFrame.GetStep();
+    int minLag = GetMinLagAt(mFrame.GetSampleRate());
+    int maxLag = std::min(frameSize - 1, GetMaxLag(size) / step + (step > 1 ? 1 : 0));
+
+    CorrelateFixedPoint(mFrame.GetSamples(), frameSize, minLag, maxLag, mFrame.GetProductScale(),
+        mCorrelation.data());
+
+    // The frame buffer holds the quantized samples already, the picker's
+    // float energies of them are what the integer sums would give
+    PitchResult result = mFramePicker.Pick(mFrame.GetBuffer(), frameSize, mCorrelation.data(), minLag, maxLag);
+    mLagView = mFramePicker.GetNormalized();
+    mLagView.step = step;
+    return result;
+}
+
+void Tuner::AutocorrelationDetector::SetAccumulation(Accumulation accumulation) {
+    PitchDetector::SetAccumulation(accumulation);
+    if (accumulation != Accumulation::FixedPoint) {
+        mPicker.SetAccumulation(accumulation);
+    }
+}
+
+float Tuner::AutocorrelationDetector::GetCost(int size) const {
+    // Lag l has size - l products
+    int minLag = GetMinLag();
+    int maxLag = GetMaxLag(size);
+    float products = (float)size * (maxLag - minLag) - 0.5f * ((float)maxLag * maxLag - (float)minLag * minLag);
+    float cost = products / kCorrelationSpeedup;
+    // Half the samples times half the lags
+    return mAccumulation == Accumulation::FixedPoint ? cost / (mFrame.GetStep() * mFrame.GetStep()) : cost;
+}
+
+// YIN
+
+void Tuner::YinDetector::Prepare(float sampleRate, int maxBlock) {
+    PitchDetector::Prepare(sampleRate, maxBlock);
+    mDifference.assign(maxBlock / 2 + 1, 0.0f);
+}
+
+PitchResult Tuner::YinDetector::Process(const float *buffer, int size) {
+    const float kThreshold = 0.15f;
+
+    int minLag = GetMinLag();
+    int maxLag = GetMaxLag(size);
+    int window = size - maxLag;
+    float *d = mDifference.data();
+
+    // Difference function
+    d[0] = 0.0f;
+    for (int tau = 1; tau <= maxLag; ++tau) {
+        float sum = 0.0f;
+        for (int i = 0; i < window; ++i) {
+            float delta = buffer[i] - buffer[i + tau];
+            sum += delta * delta;
+        }
+        d[tau] = sum;
+    }
+
+    // Cumulative mean normalization
+    d[0] = 1.0f;
+    float running = 0.0f;
+    for (int tau = 1; tau <= maxLag; ++tau) {
+        running += d[tau];
+        d[tau] = running > 0.0f ? d[tau] * tau / running : 1.0f;
+    }
+
+    mLagView = {d, 0, maxLag + 1};
+
+    // First dip below the threshold, or the global minimum if there is none
+    int best = 0;
+    for (int tau = minLag; tau < maxLag; ++tau) {
+        if (d[tau] < kThreshold) {
+            while (tau + 1 < maxLag && d[tau + 1] < d[tau]) {
+                ++tau;
+            }
+            best = tau;
+            break;
+        }
+    }
+
+    if (best == 0) {
+        best = minLag;
+        for (int tau = minLag; tau < maxLag; ++tau) {
+            if (d[tau] < d[best]) {
+                best = tau;
+            }
+        }
+    }
+
+    float lag = (float)best;
+    if (best > minLag && best + 1 < maxLag) {
+        lag += ParabolicOffset(d[best - 1], d[best], d[best + 1]);
+    }
+    return MakeResult(mSampleRate, lag, 1.0f - d[best]);
+}
+
+float Tuner::YinDetector::GetCost(int size) const {
+    int maxLag = GetMaxLag(size);
+    return 1.5f * (size - maxLag) * maxLag;
+}
+
+// NSDF
+
+void Tuner::NsdfDetector::Prepare(float sampleRate, int maxBlock) {
+    PitchDetector::Prepare(sampleRate, maxBlock);
+    mNsdf.assign(maxBlock / 2 + 1, 0.0f);
+    mFrame.Prepare(sampleRate, maxBlock);
+}
+
+PitchResult Tuner::NsdfDetector::Process(const float *buffer, int size) {
+    if (mAccumulation == Accumulation::FixedPoint) {
+        mFrame.Load(buffer, size);
+        return ProcessFrame(size);
+    }
+
+    int minLag = GetMinLag();
+    int maxLag = GetMaxLag(size);
+
+    Correlate(buffer, size, 0, maxLag + 1, mNsdf.data(), mAccumulation);
+    NormalizeSquareDifference(buffer, size, mNsdf.data(), maxLag);
+    mLagView = {mNsdf.data(), 0, maxLag + 1};
+
+    float peak = 0.0f;
+    float lag = PickNsdfPeak(mNsdf.data(), minLag, maxLag, peak);
+    return MakeResult(mSampleRate, lag, peak);
+}
+
+PitchResult Tuner::NsdfDetector::ProcessInt16(const float *buffer, const int16_t *samples, int size) {
+    if (mAccumulation != Accumulation::FixedPoint) {
+        return Process(buffer, size);
+    }
+    mFrame.Load(samples, size);
+    return ProcessFrame(size);
+}
+
+PitchResult Tuner::NsdfDetector::ProcessFrame(int size) {
+    const float *frame = mFrame.GetBuffer();
+    int frameSize = mFrame.GetSize();
+    float frameRate = mFrame.GetSampleRate();
+    int minLag = GetMinLagAt(frameRate);
+    int maxLag = GetMaxLagAt(frameRate, size / mFrame.GetStep());
+
+    CorrelateFixedPoint(mFrame.GetSamples(), frameSize, 0, maxLag + 1, mFrame.GetProductScale(), mNsdf.data());
+    NormalizeSquareDifference(frame, frameSize, mNsdf.data(), maxLag);
+    mLagView = {mNsdf.data(), 0, maxLag + 1, mFrame.GetStep()};
+
+    float peak = 0.0f;
+    float lag = PickNsdfPeak(mNsdf.data(), minLag, maxLag, peak);
+    return MakeResult(frameRate, lag, peak);
+}
+
+float Tuner::NsdfDetector::GetCost(int size) const {
+    int maxLag = GetMaxLag(size);
+    float cost = ((float)size * maxLag - 0.5f * maxLag * maxLag) / kCorrelationSpeedup;
+    return mAccumulation == Accumulation::FixedPoint ? cost / (mFrame.GetStep() * mFrame.GetStep()) : cost;
+}
+
+// FFT
+
+void Tuner::FftDetector::Prepare(float sampleRate, int maxBlock) {
+    PitchDetector::Prepare(sampleRate, maxBlock);
+    // Zero padding to twice the block keeps the correlation linear, not circular
+    mFft.Prepare(NextPowerOfTwo(2 * maxBlock));
+    mSpectrum.assign(mFft.GetSize(), 0.0f);
+    mPower.assign(mFft.GetSize() / 2 + 1, 0.0f);
+    mNsdf.assign(maxBlock / 2 + 1, 0.0f);
+}
+
+PitchResult Tuner::FftDetector::Process(const float *buffer, int size) {
+    int minLag = GetMinLag();
+    int maxLag = GetMaxLag(size);
+    int n = mFft.GetSize();
+
+    for (int i = 0; i < size; ++i) {
+        mSpectrum[i] = buffer[i];
+    }
+    std::fill(mSpectrum.begin() + size, mSpectrum.end(), 0.0f);
+
+    mFft.Forward(mSpectrum.data());
+    for (int i = 0; i < n; ++i) {
+        mSpectrum[i] = std::norm(mSpectrum[i]);
+    }
+    // Kept around for the spectrum view
+    for (int i = 0; i <= n / 2; ++i) {
+        mPower[i] = mSpectrum[i].real();
+    }
+    mFft.Inverse(mSpectrum.data());
+
+    for (int tau = 0; tau <= maxLag; ++tau) {
+        mNsdf[tau] = mSpectrum[tau].real() / n;
+    }
+    NormalizeSquareDifference(buffer, size, mNsdf.data(), maxLag);
+    mLagView = {mNsdf.data(), 0, maxLag + 1};
+
+    float peak = 0.0f;
+    float lag = PickNsdfPeak(mNsdf.data(), minLag, maxLag, peak);
+    return MakeResult(mSampleRate, lag, peak);
+}
+
+float Tuner::FftDetector::GetCost(int size) const {
+    float n = (float)NextPowerOfTwo(2 * size);
+    // Two complex transforms plus the power spectrum and normalization
+    return 2.0f * kButterflyCost * (n / 2.0f) * log2f(n) + 2.0f * n;
+}
+
+Tuner::SpectrumView Tuner::FftDetector::GetSpectrum() const {
+    SpectrumView view;
+    view.power = mPower.data();
+    view.bins = (int)mPower.size();
+    view.binHz = mSampleRate / mFft.GetSize();
+    return view;
+}
+
+// Power spectrum
+
+void Tuner::PowerSpectrum::Prepare(float sampleRate, int maxBlock) {
+    mSampleRate = sampleRate;
+    mFft.Prepare(NextPowerOfTwo(2 * maxBlock));
+    mSpectrum.assign(mFft.GetSize(), 0.0f);
+    mPower.assign(mFft.GetSize() / 2 + 1, 0.0f);
+}
+
+Tuner::SpectrumView Tuner::PowerSpectrum::Process(const float *buffer, int size) {
+    for (int i = 0; i < size; ++i) {
+        mSpectrum[i] = buffer[i];
+    }
+    std::fill(mSpectrum.begin() + size, mSpectrum.end(), 0.0f);
+
+    mFft.Forward(mSpectrum.data());
+    for (size_t i = 0; i < mPower.size(); ++i) {
+        mPower[i] = std::norm(mSpectrum[i]);
+    }
+
+    SpectrumView view;
+    view.power = mPower.data();
+    view.bins = (int)mPower.size();
+    view.binHz = mSampleRate / mFft.GetSize();
+    return view;
+}
+
+// Auto
+
+Tuner::AutoDetector::AutoDetector() {
+    for (const auto& info : GetDetectorRegistry()) {
+        if (info.type != DetectorType::Auto) {
+            mDetectors.push_back(info.create());
+        }
+    }
+}
+
+void Tuner::AutoDetector::Prepare(float sampleRate, int maxBlock) {
+    PitchDetector::Prepare(sampleRate, maxBlock);
+    for (auto& detector : mDetectors) {
+        detector->Prepare(sampleRate, maxBlock);
+    }
+    mSortedForSize = 0;
+    mLastFrequency = 0.0f;
+    mLastDetector = nullptr;
+    mRanCount = 0;
+}
+
+PitchResult Tuner::AutoDetector::Process(const float *buffer, int size) {
+    return ProcessDetectors(buffer, nullptr, size);
+}
+
+PitchResult Tuner::AutoDetector::ProcessInt16(const float *buffer, const int16_t *samples, int size) {
+    return ProcessDetectors(buffer, samples, size);
+}
+
+PitchResult Tuner::AutoDetector::ProcessDetectors(const float *buffer, const int16_t *samples, int size) {
+    if (size != mSortedForSize) {
+        SortByCost(size);
+    }
+
+    float target = GetConfidenceTarget(mLastFrequency);
+    PitchResult best;
+    mLastDetector = nullptr;
+    mLastUsed = DetectorType::Auto;
+    mRanCount = 0;
+
+    for (auto& detector : mDetectors) {
+        PitchResult result = samples ? detector->ProcessInt16(buffer, samples, size)
+            : detector->Process(buffer, size);
+        ++mRanCount;
+        if (result.frequency > 0.0f && result.confidence > best.confidence) {
+            best = result;
+            mLastUsed = detector->GetType();
+            mLastDetector = detector.get();
+        }
+        if (best.confidence >= target) {
+            break;
+        }
+    }
+
+    mLastFrequency = best.frequency;
+    return best;
+}
+
+float Tuner::AutoDetector::GetCost(int size) const {
+    float cost = 0.0f;
+    for (const auto& detector : mDetectors) {
+        cost = std::max(cost, detector->GetCost(size));
+    }
+    return cost;
+}
+
+Tuner::SpectrumView Tuner::AutoDetector::GetSpectrum() const {
+    // Only the ones that ran on this frame, the others still hold an old one.
+    // The FFT detector is one of the costlier ones and rarely runs, use a
+    // PowerSpectrum to always have one.
+    for (int i = 0; i < mRanCount; ++i) {
+        SpectrumView view = mDetectors[i]->GetSpectrum();
+        if (view.power) {
+            return view;
+        }
+    }
+    return {};
+}
+
+Tuner::LagView Tuner::AutoDetector::GetLagFunction() const {
+    // The one whose reading was used
+    return mLastDetector ? mLastDetector->GetLagFunction() : LagView();
+}
+
+void Tuner::AutoDetector::SetAccumulation(Accumulation accumulation) {
+    PitchDetector::SetAccumulation(accumulation);
+    for (auto& detector : mDetectors) {
+        detector->SetAccumulation(accumulation);
+    }
+    // Fixed point changes what the correlation detectors cost
+    mSortedForSize = 0;
+}
+
+float Tuner::AutoDetector::GetConfidenceTarget(float frequency) const {
+    // Low strings have weak fundamentals and strong harmonics, so be stricter
+    // before trusting a cheap detector there
+    if (frequency <= 0.0f) return 0.9f;
+    if (frequency < 110.0f) return 0.93f;
+    if (frequency < 250.0f) return 0.9f;
+    return 0.85f;
+}
+
+void Tuner::AutoDetector::SortByCost(int size) {
+    std::sort(mDetectors.begin(), mDetectors.end(), [size](const auto& a, const auto& b) {
+        return a->GetCost(size) < b->GetCost(size);
+    });
+    mSortedForSize = size;
+}
+
+// Registry
+
+const std::vector<Tuner::DetectorInfo>& Tuner::GetDetectorRegistry() {
+    static const std::vector<DetectorInfo> registry = {
+        {DetectorType::Auto, "Auto",
+            []() -> std::unique_ptr<PitchDetector> { return std::make_unique<AutoDetector>(); }},
+        {DetectorType::Autocorrelation, "Autocorrelation",
+            []() -> std::unique_ptr<PitchDetector> { return std::make_unique<AutocorrelationDetector>(); }},
+        {DetectorType::Yin, "YIN",
+            []() -> std::unique_ptr<PitchDetector> { return std::make_unique<YinDetector>(); }},
+        {DetectorType::Nsdf, "NSDF",
+            []() -> std::unique_ptr<PitchDetector> { return std::make_unique<NsdfDetector>(); }},
+        {DetectorType::Fft, "FFT",
+            []() -> std::unique_ptr<PitchDetector> { return std::make_unique<FftDetector>(); }},
+    };
+    return registry;
+}
+
+const Tuner::DetectorInfo& Tuner::GetDetectorInfo(DetectorType type) {
+    const auto& registry = GetDetectorRegistry();
+    for (const auto& info : registry) {
+        if (info.type == type) {
+            return info;
+        }
+    }
+    return registry.front();
+}
+
+std::unique_ptr<Tuner::PitchDetector> Tuner::CreateDetector(DetectorType type) {
+    return GetDetectorInfo(type).create();
+}
+
+bool Tuner::ParseDetector(const char *name, DetectorType &type) {
+    for (const auto& info : GetDetectorRegistry()) {
+        if (EqualsIgnoreCase(info.name, name)) {
+            type = info.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Tuner::ParseAccumulation(const char *name, Accumulation &accumulation) {
+    for (const auto& info : GetAccumulationModes()) {
+        if (EqualsIgnoreCase(info.name, name)) {
+            accumulation = info.accumulation;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "Fft.hpp"
+#include "FixedPoint.hpp"
+
+namespace Tuner {
+
+// How long correlation and energy sums are accumulated. Float is the
+// fastest, the others round less on long windows at some cost.
+enum class Accumulation {
+    Float,
+    // Float sums of short blocks, added up pairwise
+    Pairwise,
+    // Compensated float
+    Kahan,
+    Double,
+    // Vectorized float sums of short blocks, added up in double
+    Mixed,
+    // Samples quantized to int16 and summed exactly in integers, see
+    // FixedPoint.hpp. The correlation detectors also halve the rate first.
+    FixedPoint,
+};
+
+// Band the detectors search in, matches the range the app accepts
+constexpr float kMinFrequency = 20.0f;
+constexpr float kMaxFrequency = 500.0f;
+
+struct PitchResult {
+    float frequency = 0.0f;
+    // 0..1, how periodic the frame looked to the detector
+    float confidence = 0.0f;
+};
+
+// Power spectrum a detector computed along the way, bin i is at i * binHz
+struct SpectrumView {
+    const float *power = nullptr;
+    int bins = 0;
+    float binHz = 0.0f;
+};
+
+// Offset of the vertex of the parabola through three neighbouring points
+inline float ParabolicOffset(float left, float center, float right) {
+    float denom = left - 2.0f * center + right;
+    if (std::fabs(denom) < 1e-12f) return 0.0f;
+    return 0.5f * (left - right) / denom;
+}
+
+// Lag-domain function a detector picked its period from, the correlation,
+// NSDF or YIN difference. Entries in [begin, end) are valid.
+struct LagView {
+    const float *values = nullptr;
+    int begin = 0;
+    int end = 0;
+    // Input samples per lag, more than 1 when the detector decimated
+    int step = 1;
+};
+
+enum class DetectorType {
+    Autocorrelation,
+    Yin,
+    Nsdf,
+    Fft,
+    Auto,
+};
+
+// Detectors own their workspace: Prepare allocates it once and Process
+// reuses it, so steady-state analysis never touches the heap.
+class PitchDetector {
+public:
+    virtual ~PitchDetector() = default;
+
+    virtual void Prepare(float sampleRate, int maxBlock);
+    // size must not exceed the maxBlock passed to Prepare
+    virtual PitchResult Process(const float *buffer, int size) = 0;
+    // Same, with the 16 bit samples buffer was converted from. The
+    // Accumulation::FixedPoint detectors load those instead of quantizing
+    // buffer again, the others analyze buffer.
+    virtual PitchResult ProcessInt16(const float *buffer, const int16_t *, int size) {
+        return Process(buffer, size);
+    }
+
+    virtual DetectorType GetType() const = 0;
+    // Detector that produced the last Process result, Auto's picks one
+    virtual DetectorType GetEngine() const {
+        return GetType();
+    }
+    // Rough time for a block of this size, in scalar multiply-adds, as
+    // measured against YIN's plain loop. Auto tries detectors in this order.
+    virtual float GetCost(int size) const = 0;
+
+    // Spectrum from the last Process call, empty if the detector has none
+    virtual SpectrumView GetSpectrum() const {
+        return {};
+    }
+
+    // Lag function from the last Process call
+    virtual LagView GetLagFunction() const {
+        return mLagView;
+    }
+
+    // Only the correlation based detectors use it, the rest ignore it
+    virtual void SetAccumulation(Accumulation accumulation) {
+        mAccumulation = accumulation;
+    }
+
+    inline Accumulation GetAccumulation() const {
+        return mAccumulation;
+    }
+
+protected:
+    float mSampleRate = 0.0f;
+    int mMaxBlock = 0;
+    LagView mLagView;
+    Accumulation mAccumulation = Accumulation::Float;
+
+    // Lag range covering kMinFrequency..kMaxFrequency for a block size
+    int GetMinLag() const;
+    int GetMaxLag(int size) const;
+};
+
+// Picks the period from a raw autocorrelation without the octave errors its
+// global maximum makes. Shorter lags sum more terms, so the raw maximum
+// leans towards them and lands on the 2nd harmonic of low strings.
+//
+// The correlation is normalized by the energy of both overlapping parts,
+// which makes every period read close to 1, and the shortest lag near the
+// best one is taken. Whether the true period is 2 or 3 times that lag, with
+// a fundamental too weak to show in the correlation, is then decided on the
+// spectrum: a real lower pitch puts energy on harmonics the higher one
+// doesn't have. The previous reading tips that decision when it's close.
+class PeriodPicker {
+public:
+    void Prepare(float sampleRate, int maxBlock);
+    // Forgets the previous reading, for when the input changes
+    void Reset();
+
+    // correlation holds r(lag) of buffer for lags in [minLag, maxLag)
+    PitchResult Pick(const float *buffer, int size, const float *correlation, int minLag, int maxLag);
+
+    // Normalized correlation from the last Pick
+    inline LagView GetNormalized() const {
+        return mNormalizedView;
+    }
+
+    // For the frame energy the correlation is normalized by
+    inline void SetAccumulation(Accumulation accumulation) {
+        mAccumulation = accumulation;
+    }
+
+private:
+    float mSampleRate = 0.0f;
+    Accumulation mAccumulation = Accumulation::Float;
+    std::vector<float> mNormalized;
+    std::vector<float> mWindow;
+    LagView mNormalizedView;
+    float mPriorLag = 0.0f;
+
+    void Normalize(const float *buffer, int size, const float *correlation, int minLag, int maxLag);
+    // Highest normalized value within a few percent of lag
+    int FindPeakNear(float lag, int minLag, int maxLag) const;
+    // Energy on the harmonics only the period lag * multiple has, relative
+    // to the ones it shares with lag
+    float GetSubharmonicRatio(const float *buffer, int size, float lag, int multiple);
+    // Goertzel power of the windowed frame at each frequency
+    void GetPowers(const float *buffer, int size, const float *frequencies, int count, float *powers);
+};
+
+// Plain time-domain autocorrelation, the original darktuna detector
+class AutocorrelationDetector : public PitchDetector {
+public:
+    void Prepare(float sampleRate, int maxBlock) override;
+    PitchResult Process(const float *buffer, int size) override;
+    PitchResult ProcessInt16(const float *buffer, const int16_t *samples, int size) override;
+    void SetAccumulation(Accumulation accumulation) override;
+
+    DetectorType GetType() const override {
+        return DetectorType::Autocorrelation;
+    }
+    float GetCost(int size) const override;
+
+private:
+    std::vector<float> mCorrelation;
+    PeriodPicker mPicker;
+    // Accumulation::FixedPoint runs on this frame, with a picker at its rate
+    FixedPointFrame mFrame;
+    PeriodPicker mFramePicker;
+
+    // Analyzes mFrame once it holds the block
+    PitchResult ProcessFrame(int size);
+};
+
+// YIN: cumulative mean normalized difference with an absolute threshold
+class YinDetector : public PitchDetector {
+public:
+    void Prepare(float sampleRate, int maxBlock) override;
+    PitchResult Process(const float *buffer, int size) override;
+
+    DetectorType GetType() const override {
+        return DetectorType::Yin;
+    }
+    float GetCost(int size) const override;
+
+private:
+    std::vector<float> mDifference;
+};
+
+// McLeod normalized square difference function
+class NsdfDetector : public PitchDetector {
+public:
+    void Prepare(float sampleRate, int maxBlock) override;
+    PitchResult Process(const float *buffer, int size) override;
+    PitchResult ProcessInt16(const float *buffer, const int16_t *samples, int size) override;
+
+    DetectorType GetType() const override {
+        return DetectorType::Nsdf;
+    }
+    float GetCost(int size) const override;
+
+private:
+    std::vector<float> mNsdf;
+    FixedPointFrame mFrame;
+
+    PitchResult ProcessFrame(int size);
+};
+
+// NSDF with the autocorrelation term computed through the FFT
+class FftDetector : public PitchDetector {
+public:
+    void Prepare(float sampleRate, int maxBlock) override;
+    PitchResult Process(const float *buffer, int size) override;
+
+    DetectorType GetType() const override {
+        return DetectorType::Fft;
+    }
+    float GetCost(int size) const override;
+    SpectrumView GetSpectrum() const override;
+
+private:
+    Fft mFft;
+    std::vector<std::complex<float>> mSpectrum;
+    std::vector<float> mPower;
+    std::vector<float> mNsdf;
+};
+
+// Power spectrum of a block, with the FFT detector's padding and bins, for
+// a view when the detector that ran didn't make one. Prepare allocates,
+// Process doesn't.
+class PowerSpectrum {
+public:
+    void Prepare(float sampleRate, int maxBlock);
+    // Valid until the next call
+    SpectrumView Process(const float *buffer, int size);
+
+private:
+    float mSampleRate = 0.0f;
+    Fft mFft;
+    std::vector<std::complex<float>> mSpectrum;
+    std::vector<float> mPower;
+};
+
+struct DetectorInfo {
+    DetectorType type;
+    const char *name;
+    std::unique_ptr<PitchDetector> (*create)();
+};
+
+// All detectors that can be selected at runtime, in display order
+const std::vector<DetectorInfo>& GetDetectorRegistry();
+const DetectorInfo& GetDetectorInfo(DetectorType type);
+std::unique_ptr<PitchDetector> CreateDetector(DetectorType type);
+// By the registry names and the GetAccumulationModes ones, ignoring case,
+// for command lines. Leave the value alone and return false when unknown.
+bool ParseDetector(const char *name, DetectorType &type);
+bool ParseAccumulation(const char *name, Accumulation &accumulation);
+
+// Picks the cheapest detector that reaches the confidence target for the
+// register of the previous reading, falling back to costlier ones.
+class AutoDetector : public PitchDetector {
+public:
+    AutoDetector();
+
+    void Prepare(float sampleRate, int maxBlock) override;
+    PitchResult Process(const float *buffer, int size) override;
+    PitchResult ProcessInt16(const float *buffer, const int16_t *samples, int size) override;
+
+    DetectorType GetType() const override {
+        return DetectorType::Auto;
+    }
+    float GetCost(int size) const override;
+    SpectrumView GetSpectrum() const override;
+    LagView GetLagFunction() const override;
+    void SetAccumulation(Accumulation accumulation) override;
+
+    // Confidence needed before a cheaper detector's reading is accepted
+    float GetConfidenceTarget(float frequency) const;
+
+    // Auto again when none of them found a pitch
+    DetectorType GetEngine() const override {
+        return mLastUsed;
+    }
+
+private:
+    std::vector<std::unique_ptr<PitchDetector>> mDetectors;
+    PitchDetector *mLastDetector = nullptr;
+    // How many of mDetectors, cheapest first, ran in the last Process call
+    int mRanCount = 0;
+    float mLastFrequency = 0.0f;
+    DetectorType mLastUsed = DetectorType::Auto;
+    int mSortedForSize = 0;
+
+    void SortByCost(int size);
+    // Both Process calls, samples is null for float input
+    PitchResult ProcessDetectors(const float *buffer, const int16_t *samples, int size);
+};
+
+} // namespace Tuner
@@ -0,0 +1,109 @@
+#include "PreFilter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float kPi = 3.14159265f;
+// Corner of the DC blocker, far below the lowest string
+const float kDcCutoff = 5.0f;
+
+} // namespace
+
+void Tuner::PreFilter::Prepare(float sampleRate) {
+    mSampleRate = sampleRate;
+
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    ApplyConfig(mConfig);
+    mConfigChanged = false;
+}
+
+void Tuner::PreFilter::SetConfig(const PreFilterConfig &config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mConfig = config;
+    mConfigChanged = true;
+}
+
+Tuner::PreFilterConfig Tuner::PreFilter::GetConfig() {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    return mConfig;
+}
+
+void Tuner::PreFilter::SetSection(int index, float b0, float b1, float b2, float a0, float a1, float a2) {
+    mB0[index] = b0 / a0;
+    mB1[index] = b1 / a0;
+    mB2[index] = b2 / a0;
+    mA1[index] = a1 / a0;
+    mA2[index] = a2 / a0;
+}
+
+void Tuner::PreFilter::ApplyConfig(const PreFilterConfig &config) {
+    int count = 0;
+
+    if (config.dcBlocker) {
+        float r = 1.0f - 2.0f * kPi * kDcCutoff / mSampleRate;
+        SetSection(count++, 1.0f, -1.0f, 0.0f, 1.0f, -r, 0.0f);
+    }
+
+    if (config.highPass) {
+        // Two sections with the 4th order Butterworth Q values
+        for (float q : {0.5412f, 1.3066f}) {
+            float w0 = 2.0f * kPi * config.highPassFrequency / mSampleRate;
+            float alpha = sinf(w0) / (2.0f * q);
+            float c = cosf(w0);
+            SetSection(count++, (1.0f + c) / 2.0f, -(1.0f + c), (1.0f + c) / 2.0f,
+                1.0f + alpha, -2.0f * c, 1.0f - alpha);
+        }
+    }
+
+    if (config.mainsFrequency > 0.0f) {
+        for (int h = 1; h <= config.mainsHarmonics && count < kMaxSections; ++h) {
+            float freq = config.mainsFrequency * h;
+            if (freq >= mSampleRate * 0.5f) break;
+
+            float w0 = 2.0f * kPi * freq / mSampleRate;
+            float alpha = sinf(w0) / (2.0f * config.notchQ);
+            float c = cosf(w0);
+            SetSection(count++, 1.0f, -2.0f * c, 1.0f, 1.0f + alpha, -2.0f * c, 1.0f - alpha);
+        }
+    }
+
+    mNumSections = count;
+    for (; count < kMaxSections; ++count) {
+        SetSection(count, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+    }
+
+    std::fill(mS1, mS1 + kMaxSections, 0.0f);
+    std::fill(mS2, mS2 + kMaxSections, 0.0f);
+    std::fill(mStage, mStage + kMaxSections, 0.0f);
+}
+
+void Tuner::PreFilter::Process(float *buffer, int size) {
+    // Pick up new settings without ever waiting on the UI thread
+    if (mConfigChanged.load(std::memory_order_acquire) && mConfigMutex.try_lock()) {
+        ApplyConfig(mConfig);
+        mConfigChanged = false;
+        mConfigMutex.unlock();
+    }
+
+    if (mNumSections == 0) return;
+
+    for (int n = 0; n < size; ++n) {
+        // Each section takes what the one before it produced last step
+        float in[kMaxSections];
+        in[0] = buffer[n];
+        for (int k = 1; k < kMaxSections; ++k) {
+            in[k] = mStage[k - 1];
+        }
+
+        for (int k = 0; k < kMaxSections; ++k) {
+            float y = mB0[k] * in[k] + mS1[k];
+            mS1[k] = mB1[k] * in[k] - mA1[k] * y + mS2[k];
+            mS2[k] = mB2[k] * in[k] - mA2[k] * y;
+            mStage[k] = y;
+        }
+
+        buffer[n] = mStage[kMaxSections - 1];
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace Tuner {
+
+struct PreFilterConfig {
+    // First order DC blocker
+    bool dcBlocker = true;
+    // Notches at the mains frequency and its harmonics, 0 disables them
+    float mainsFrequency = 50.0f;
+    int mainsHarmonics = 3;
+    float notchQ = 30.0f;
+    // Optional 4th order Butterworth high-pass
+    bool highPass = false;
+    float highPassFrequency = 30.0f;
+};
+
+// Cleans up the input before any detector sees it: removes DC offset and
+// mains hum that would otherwise pull correlation peaks towards long lags.
+//
+// All sections run as one cascade that is pipelined across SIMD lanes: at
+// every step section k filters the sample section k-1 produced one step
+// earlier, so the eight sections update together as plain lane-wise math.
+// The price is a fixed delay of kMaxSections - 1 samples.
+//
+// Process runs in place on the audio thread and never blocks or allocates,
+// SetConfig may be called from any thread.
+class PreFilter {
+public:
+    static constexpr int kMaxSections = 8;
+
+    void Prepare(float sampleRate);
+    void SetConfig(const PreFilterConfig &config);
+    PreFilterConfig GetConfig();
+
+    void Process(float *buffer, int size);
+
+    inline int GetNumSections() const {
+        return mNumSections;
+    }
+
+private:
+    float mSampleRate = 44100.0f;
+
+    std::mutex mConfigMutex;
+    PreFilterConfig mConfig;
+    std::atomic<bool> mConfigChanged{true};
+
+    // Transposed direct form II coefficients and state, one lane per section.
+    // Unused lanes are pass-through.
+    float mB0[kMaxSections];
+    float mB1[kMaxSections];
+    float mB2[kMaxSections];
+    float mA1[kMaxSections];
+    float mA2[kMaxSections];
+    float mS1[kMaxSections] = {};
+    float mS2[kMaxSections] = {};
+    // Output of each section from the previous step
+    float mStage[kMaxSections] = {};
+    int mNumSections = 0;
+
+    void ApplyConfig(const PreFilterConfig &config);
+    void SetSection(int index, float b0, float b1, float b2, float a0, float a1, float a2);
+};
+
+} // namespace Tuner
@@ -0,0 +1,159 @@
+#include "Strobe.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const double kTwoPi = 6.283185307179586;
+
+// Low-pass corner for the baseband, well below the 2f mixing product of the
+// lowest strings but wide enough to follow a string being turned
+const float kFilterCutoff = 6.0f;
+// Time constant of the drift average, longer is steadier but slower
+const float kDriftTime = 0.5f;
+// Time for the filter cascade to forget its start-up transient
+const float kSettleTime = 0.15f;
+// Baseband magnitude below which the phase is just noise
+const float kMinMagnitude = 1e-4f;
+
+} // namespace
+
+void Tuner::Strobe::Prepare(float sampleRate) {
+    mSampleRate = sampleRate;
+    Reset(mReference.load(std::memory_order_relaxed));
+}
+
+void Tuner::Strobe::SetReference(float frequency) {
+    mReference.store(frequency, std::memory_order_relaxed);
+}
+
+void Tuner::Strobe::Reset(float frequency) {
+    mActiveReference = frequency;
+
+    double w = kTwoPi * frequency / mSampleRate;
+    for (int k = 0; k < kChunkSize; ++k) {
+        mTableCos[k] = (float)cos(w * k);
+        mTableSin[k] = (float)-sin(w * k);
+    }
+    mPhasor = 1.0;
+    mChunkRotation = std::polar(1.0, -w * kChunkSize);
+
+    float chunkRate = mSampleRate / kChunkSize;
+    mFilterAlpha = 1.0f - expf(-(float)kTwoPi * kFilterCutoff / chunkRate);
+    mDriftAlpha = 1.0f - expf(-1.0f / (kDriftTime * chunkRate));
+
+    for (auto& stage : mFilter) {
+        stage = 0.0f;
+    }
+    mPrevious = 0.0f;
+    mDrift = 0.0f;
+    mPhase = 0.0;
+    mSettleChunks = 0;
+    mPendingCount = 0;
+
+    mCentsOut.store(0.0f, std::memory_order_relaxed);
+    mLockedOut.store(false, std::memory_order_relaxed);
+}
+
+void Tuner::Strobe::Process(const float *buffer, int size) {
+    float reference = mReference.load(std::memory_order_relaxed);
+    if (reference != mActiveReference) {
+        Reset(reference);
+    }
+    if (mActiveReference <= 0.0f) return;
+
+    while (size > 0) {
+        // Mix straight from the callback buffer when chunks line up
+        if (mPendingCount == 0 && size >= kChunkSize) {
+            ProcessChunk(buffer);
+            buffer += kChunkSize;
+            size -= kChunkSize;
+            continue;
+        }
+
+        int count = std::min(kChunkSize - mPendingCount, size);
+        memcpy(mPending + mPendingCount, buffer, count * sizeof(float));
+        mPendingCount += count;
+        buffer += count;
+        size -= count;
+
+        if (mPendingCount == kChunkSize) {
+            ProcessChunk(mPending);
+            mPendingCount = 0;
+        }
+    }
+}
+
+void Tuner::Strobe::ProcessChunk(const float *chunk) {
+    // Split accumulators break the add dependency chain so the loop
+    // vectorizes without needing fast-math reassociation
+    const int kLanes = 8;
+    float sumCos[kLanes] = {};
+    float sumSin[kLanes] = {};
+
+    for (int k = 0; k < kChunkSize; k += kLanes) {
+        for (int lane = 0; lane < kLanes; ++lane) {
+            sumCos[lane] += chunk[k + lane] * mTableCos[k + lane];
+            sumSin[lane] += chunk[k + lane] * mTableSin[k + lane];
+        }
+    }
+
+    float a = 0.0f;
+    float b = 0.0f;
+    for (int lane = 0; lane < kLanes; ++lane) {
+        a += sumCos[lane];
+        b += sumSin[lane];
+    }
+
+    // The table starts at phase 0, rotate it to where the oscillator is
+    std::complex<double> mixed = mPhasor * std::complex<double>(a, b);
+    mPhasor *= mChunkRotation;
+    mPhasor /= std::abs(mPhasor);
+
+    std::complex<float> z((float)mixed.real() / kChunkSize, (float)mixed.imag() / kChunkSize);
+    for (auto& stage : mFilter) {
+        stage += mFilterAlpha * (z - stage);
+        z = stage;
+    }
+
+    float chunkRate = mSampleRate / kChunkSize;
+    bool hasSignal = std::abs(z) > kMinMagnitude;
+    if (hasSignal && std::abs(mPrevious) > kMinMagnitude) {
+        float step = std::arg(z * std::conj(mPrevious));
+        mPhase = fmod(mPhase + step, kTwoPi);
+
+        int settleChunks = (int)(kSettleTime * chunkRate);
+        if (mSettleChunks == settleChunks) {
+            mDrift = step;
+        } else if (mSettleChunks > settleChunks) {
+            mDrift += mDriftAlpha * (step - mDrift);
+        }
+        ++mSettleChunks;
+    } else if (!hasSignal) {
+        mSettleChunks = 0;
+    }
+    mPrevious = z;
+
+    float offset = mDrift * chunkRate / (float)kTwoPi;
+    float cents = 1200.0f * log2f((mActiveReference + offset) / mActiveReference);
+    float phase = (float)(mPhase / kTwoPi);
+
+    mCentsOut.store(cents, std::memory_order_relaxed);
+    mPhaseOut.store(phase - floorf(phase), std::memory_order_relaxed);
+    bool locked = mSettleChunks > (kSettleTime + kDriftTime) * chunkRate;
+    mLockedOut.store(locked, std::memory_order_relaxed);
+}
+
+float Tuner::Strobe::GetCentsOff() const {
+    return mCentsOut.load(std::memory_order_relaxed);
+}
+
+float Tuner::Strobe::GetPhase() const {
+    return mPhaseOut.load(std::memory_order_relaxed);
+}
+
+bool Tuner::Strobe::IsLocked() const {
+    return mLockedOut.load(std::memory_order_relaxed);
+}
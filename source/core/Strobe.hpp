@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+
+namespace Tuner {
+
+// Heterodyne strobe: mixes the input down against a quadrature oscillator at
+// the reference frequency and tracks how fast the baseband phase rotates.
+// A string that is 0.1 cents off turns the phase by 0.1 / 1200 of a cycle
+// per reference period, so averaging the drift gives sub-cent readings
+// without any lag resolution limit.
+//
+// Process runs on the audio thread, the getters and SetReference are safe to
+// call from the UI thread. Nothing allocates after construction.
+class Strobe {
+public:
+    // Samples mixed per decimated output, the oscillator is re-anchored in
+    // double precision at every chunk boundary so it never drifts
+    static constexpr int kChunkSize = 64;
+
+    void Prepare(float sampleRate);
+    void SetReference(float frequency);
+    void Process(const float *buffer, int size);
+
+    // Frequency error against the reference from the averaged drift rate
+    float GetCentsOff() const;
+    // Heterodyne phase in cycles, this is what a mechanical strobe shows
+    float GetPhase() const;
+    // True once the filters settled on a signal at the current reference
+    bool IsLocked() const;
+
+    inline float GetReference() const {
+        return mReference.load(std::memory_order_relaxed);
+    }
+
+private:
+    float mSampleRate = 44100.0f;
+    std::atomic<float> mReference{0.0f};
+    float mActiveReference = 0.0f;
+
+    // Oscillator, the table holds e^(-jwk) for one chunk
+    float mTableCos[kChunkSize];
+    float mTableSin[kChunkSize];
+    std::complex<double> mPhasor = 1.0;
+    std::complex<double> mChunkRotation = 1.0;
+
+    // Partial chunk carried between callbacks
+    float mPending[kChunkSize];
+    int mPendingCount = 0;
+
+    // Low-pass cascade on the decimated baseband signal
+    std::complex<float> mFilter[3];
+    float mFilterAlpha = 0.0f;
+    std::complex<float> mPrevious = 0.0f;
+
+    // Smoothed phase step per chunk in radians
+    float mDrift = 0.0f;
+    float mDriftAlpha = 0.0f;
+    double mPhase = 0.0;
+    int mSettleChunks = 0;
+
+    std::atomic<float> mCentsOut{0.0f};
+    std::atomic<float> mPhaseOut{0.0f};
+    std::atomic<bool> mLockedOut{false};
+
+    void Reset(float frequency);
+    void ProcessChunk(const float *chunk);
+};
+
+} // namespace Tuner
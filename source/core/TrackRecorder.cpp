@@ -0,0 +1,36 @@
+#include "TrackRecorder.hpp"
+
+Tuner::TrackRecorder::~TrackRecorder() {
+    Close();
+}
+
+bool Tuner::TrackRecorder::Open(const std::string &path) {
+    Close();
+
+    mFile = fopen(path.c_str(), "w");
+    if (!mFile) return false;
+
+    mPath = path;
+    fprintf(mFile, "input_time,published_time,presented_time,result_latency_ms,display_latency_ms,"
+        "frequency,confidence,note,cents_off,detector\n");
+    return true;
+}
+
+void Tuner::TrackRecorder::Close() {
+    if (mFile) {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+void Tuner::TrackRecorder::Write(const RecordedReading &reading) {
+    if (!mFile) return;
+
+    const ReadingTimes &times = reading.times;
+    // A reading that was never presented has no display latency
+    double display = times.presented > 0.0 ? times.GetDisplayLatency() * 1000.0 : 0.0;
+    fprintf(mFile, "%.6f,%.6f,%.6f,%.3f,%.3f,%.3f,%.3f,%s,%.2f,%s\n",
+        times.input, times.published, times.presented, times.GetResultLatency() * 1000.0, display,
+        reading.frequency, reading.confidence, reading.note ? reading.note->name.c_str() : "",
+        reading.centsOff, reading.detector);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "Latency.hpp"
+#include "Note.hpp"
+
+namespace Tuner {
+
+struct RecordedReading {
+    ReadingTimes times;
+    float frequency = 0.0f;
+    float confidence = 0.0f;
+    // Null when nothing was detected
+    const Note *note = nullptr;
+    float centsOff = 0.0f;
+    const char *detector = "";
+};
+
+// Writes readings as CSV rows, one per reading with its capture, publish and
+// present times and the latencies between them, so a track can be lined up
+// with the audio and checked against a latency budget afterwards.
+class TrackRecorder {
+public:
+    TrackRecorder() = default;
+    ~TrackRecorder();
+
+    TrackRecorder(const TrackRecorder&) = delete;
+    TrackRecorder& operator=(const TrackRecorder&) = delete;
+
+    // Creates the file and writes the header
+    bool Open(const std::string &path);
+    void Close();
+
+    inline bool IsOpen() const {
+        return mFile != nullptr;
+    }
+
+    inline const std::string& GetPath() const {
+        return mPath;
+    }
+
+    void Write(const RecordedReading &reading);
+
+private:
+    FILE *mFile = nullptr;
+    std::string mPath;
+};
+
+} // namespace Tuner
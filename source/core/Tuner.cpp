@@ -2,17 +2,28 @@
 
 #include <cmath>
 
+#include "Correlation.hpp"
+
 float Tuner::DetectFrequencyAutocorrelation(const float *buffer, int size, float sample_rate) {
+    int best_lag = FindCorrelationPeak(buffer, size, 20, size / 2);
+    if (best_lag == 0) return 0.0f;
+    return sample_rate / best_lag;
+}
+
+float Tuner::DetectFrequencyAutocorrelation(const float *buffer, int size, float sample_rate, float *correlation,
+    Accumulation accumulation, int16_t *scratch) {
+    const int min_lag = 20;
+    int max_lag = size / 2;
+    if (max_lag <= min_lag) return 0.0f;
+
+    Correlate(buffer, size, min_lag, max_lag, correlation, accumulation, scratch);
+
     int best_lag = 0;
     float max_correlation = 0.0f;
 
-    for (int lag = 20; lag < size / 2; ++lag) {
-        float sum = 0.0f;
-        for (int i = 0; i < size - lag; ++i) {
-            sum += buffer[i] * buffer[i + lag];
-        }
-        if (sum > max_correlation) {
-            max_correlation = sum;
+    for (int lag = min_lag; lag < max_lag; ++lag) {
+        if (correlation[lag] > max_correlation) {
+            max_correlation = correlation[lag];
             best_lag = lag;
         }
     }
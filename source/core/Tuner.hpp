@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Note.hpp"
+#include "PitchDetector.hpp"
+
+namespace Tuner {
+
+// Lag of the raw correlation maximum, as it always was. On low strings that
+// can be a harmonic, the detectors correct octaves with PeriodPicker. Needs
+// no buffer and allocates nothing.
+float DetectFrequencyAutocorrelation(const float *buffer, int size, float sample_rate);
+// Same, and leaves the whole correlation for lags 20..size/2 in correlation
+// (size / 2 entries) for smoothing, other peak picking or drawing. scratch
+// is what Correlate takes for Accumulation::FixedPoint.
+float DetectFrequencyAutocorrelation(const float *buffer, int size, float sample_rate, float *correlation,
+    Accumulation accumulation = Accumulation::Float, int16_t *scratch = nullptr);
+const Note& GetClosestNote(float freq);
+float GetCentsOff(float freq, float refFreq);
+
+} // namespace Tuner
@@ -0,0 +1,169 @@
+#include "darktuna.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "Analyzer.hpp"
+
+struct darktuna_tuner {
+    Tuner::Analyzer analyzer;
+};
+
+namespace {
+
+// Copies what the caller's struct has over our defaults, so callers built
+// against an older, shorter struct keep working
+template <typename T>
+T ReadVersioned(const T *source, const T &defaults) {
+    T result = defaults;
+    size_t size = std::min(source->struct_size, sizeof(T));
+    memcpy(&result, source, size);
+    result.struct_size = sizeof(T);
+    return result;
+}
+
+bool ToDetectorType(darktuna_detector detector, Tuner::DetectorType &type) {
+    switch (detector) {
+        case DARKTUNA_DETECTOR_AUTOCORRELATION: type = Tuner::DetectorType::Autocorrelation; return true;
+        case DARKTUNA_DETECTOR_YIN: type = Tuner::DetectorType::Yin; return true;
+        case DARKTUNA_DETECTOR_NSDF: type = Tuner::DetectorType::Nsdf; return true;
+        case DARKTUNA_DETECTOR_FFT: type = Tuner::DetectorType::Fft; return true;
+        case DARKTUNA_DETECTOR_AUTO: type = Tuner::DetectorType::Auto; return true;
+    }
+    return false;
+}
+
+bool ToAccumulation(darktuna_accumulation accumulation, Tuner::Accumulation &mode) {
+    switch (accumulation) {
+        case DARKTUNA_ACCUMULATION_FLOAT: mode = Tuner::Accumulation::Float; return true;
+        case DARKTUNA_ACCUMULATION_PAIRWISE: mode = Tuner::Accumulation::Pairwise; return true;
+        case DARKTUNA_ACCUMULATION_KAHAN: mode = Tuner::Accumulation::Kahan; return true;
+        case DARKTUNA_ACCUMULATION_DOUBLE: mode = Tuner::Accumulation::Double; return true;
+        case DARKTUNA_ACCUMULATION_MIXED: mode = Tuner::Accumulation::Mixed; return true;
+        case DARKTUNA_ACCUMULATION_INT16: mode = Tuner::Accumulation::FixedPoint; return true;
+    }
+    return false;
+}
+
+void WriteResult(const Tuner::AnalyzerResult &analyzed, darktuna_result *result) {
+    darktuna_result out;
+    darktuna_result_init(&out);
+    out.sample_index = analyzed.sampleIndex;
+    out.input_time = analyzed.inputTime;
+    out.rms = analyzed.rms;
+    out.voiced = analyzed.voiced ? 1 : 0;
+    out.frequency = analyzed.frequency;
+    out.confidence = analyzed.confidence;
+    if (analyzed.note) {
+        out.note_name = analyzed.note->name.c_str();
+        out.note_frequency = analyzed.note->freq;
+        out.cents_off = analyzed.centsOff;
+    }
+
+    // Only write as much as the caller's struct has room for
+    size_t size = std::min(result->struct_size, sizeof(darktuna_result));
+    out.struct_size = result->struct_size;
+    memcpy(result, &out, size);
+}
+
+} // namespace
+
+void darktuna_config_init(darktuna_config *config) {
+    if (!config) return;
+
+    Tuner::AnalyzerConfig defaults;
+    config->struct_size = sizeof(darktuna_config);
+    config->sample_rate = defaults.sampleRate;
+    config->window_size = defaults.windowSize;
+    config->hop_size = defaults.hopSize;
+    config->detector = DARKTUNA_DETECTOR_AUTO;
+    config->adaptive_gate = defaults.adaptiveGate ? 1 : 0;
+    config->rms_threshold = defaults.rmsThreshold;
+    config->mains_frequency = defaults.preFilter.mainsFrequency;
+    config->high_pass_frequency = defaults.preFilter.highPass ? defaults.preFilter.highPassFrequency : 0.0f;
+    config->accumulation = DARKTUNA_ACCUMULATION_FLOAT;
+}
+
+void darktuna_result_init(darktuna_result *result) {
+    if (!result) return;
+
+    memset(result, 0, sizeof(darktuna_result));
+    result->struct_size = sizeof(darktuna_result);
+}
+
+darktuna_tuner *darktuna_create(const darktuna_config *config) {
+    if (!config) return nullptr;
+
+    darktuna_config defaults;
+    darktuna_config_init(&defaults);
+    darktuna_config c = ReadVersioned(config, defaults);
+
+    Tuner::AnalyzerConfig analyzerConfig;
+    if (!ToDetectorType(c.detector, analyzerConfig.detector)) return nullptr;
+    if (!ToAccumulation(c.accumulation, analyzerConfig.accumulation)) return nullptr;
+    if (c.sample_rate <= 0.0f || c.window_size < 64 || c.hop_size <= 0) return nullptr;
+
+    analyzerConfig.sampleRate = c.sample_rate;
+    analyzerConfig.windowSize = c.window_size;
+    analyzerConfig.hopSize = c.hop_size;
+    analyzerConfig.adaptiveGate = c.adaptive_gate != 0;
+    analyzerConfig.rmsThreshold = c.rms_threshold;
+    analyzerConfig.preFilter.mainsFrequency = c.mains_frequency;
+    analyzerConfig.preFilter.highPass = c.high_pass_frequency > 0.0f;
+    if (analyzerConfig.preFilter.highPass) {
+        analyzerConfig.preFilter.highPassFrequency = c.high_pass_frequency;
+    }
+
+    darktuna_tuner *tuner = new (std::nothrow) darktuna_tuner();
+    if (!tuner) return nullptr;
+
+    try {
+        tuner->analyzer.Prepare(analyzerConfig);
+    } catch (...) {
+        delete tuner;
+        return nullptr;
+    }
+    return tuner;
+}
+
+void darktuna_destroy(darktuna_tuner *tuner) {
+    delete tuner;
+}
+
+int darktuna_process(darktuna_tuner *tuner, const float *samples, int count, darktuna_result *result) {
+    return darktuna_process_timed(tuner, samples, count, 0.0, result);
+}
+
+int darktuna_process_timed(darktuna_tuner *tuner, const float *samples, int count, double time,
+    darktuna_result *result) {
+    if (!tuner || (!samples && count > 0) || count < 0 || !result) return -1;
+
+    Tuner::AnalyzerResult analyzed;
+    if (!tuner->analyzer.Process(samples, count, analyzed, time)) return 0;
+
+    WriteResult(analyzed, result);
+    return 1;
+}
+
+int darktuna_process_int16(darktuna_tuner *tuner, const short *samples, int count, double time,
+    darktuna_result *result) {
+    if (!tuner || (!samples && count > 0) || count < 0 || !result) return -1;
+
+    Tuner::AnalyzerResult analyzed;
+    if (!tuner->analyzer.Process((const int16_t *)samples, count, analyzed, time)) return 0;
+
+    WriteResult(analyzed, result);
+    return 1;
+}
+
+void darktuna_reset(darktuna_tuner *tuner) {
+    if (!tuner) return;
+
+    Tuner::AnalyzerConfig config = tuner->analyzer.GetConfig();
+    tuner->analyzer.Prepare(config);
+}
+
+int darktuna_version(void) {
+    return DARKTUNA_VERSION_MAJOR * 10000 + DARKTUNA_VERSION_MINOR * 100;
+}
@@ -0,0 +1,122 @@
+/*
+ * C interface to the darktuna analysis engine, for embedding the detector in
+ * audio hosts and plugins without the GUI.
+ *
+ * The caller owns all audio memory: darktuna_process reads a block of mono
+ * float samples of any length and never keeps the pointer. A tuner allocates
+ * everything in darktuna_create, so darktuna_process is safe to call from a
+ * real-time audio thread. A tuner is not thread-safe, use one per stream.
+ *
+ * Structs passed in start with struct_size so fields can be added without
+ * breaking callers built against an older header. Always initialize them
+ * with the matching *_init function.
+ */
+#ifndef DARKTUNA_H
+#define DARKTUNA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DARKTUNA_VERSION_MAJOR 1
+#define DARKTUNA_VERSION_MINOR 3
+
+typedef struct darktuna_tuner darktuna_tuner;
+
+typedef enum darktuna_detector {
+    DARKTUNA_DETECTOR_AUTOCORRELATION = 0,
+    DARKTUNA_DETECTOR_YIN = 1,
+    DARKTUNA_DETECTOR_NSDF = 2,
+    DARKTUNA_DETECTOR_FFT = 3,
+    DARKTUNA_DETECTOR_AUTO = 4
+} darktuna_detector;
+
+/* How correlation and RMS sums are accumulated, see darktuna_bench --accuracy */
+typedef enum darktuna_accumulation {
+    DARKTUNA_ACCUMULATION_FLOAT = 0,
+    DARKTUNA_ACCUMULATION_PAIRWISE = 1,
+    DARKTUNA_ACCUMULATION_KAHAN = 2,
+    DARKTUNA_ACCUMULATION_DOUBLE = 3,
+    DARKTUNA_ACCUMULATION_MIXED = 4,
+    /* Since 1.3, integer kernels on int16 samples */
+    DARKTUNA_ACCUMULATION_INT16 = 5
+} darktuna_accumulation;
+
+typedef struct darktuna_config {
+    size_t struct_size;
+    float sample_rate;
+    /* Samples per analysis and between analyses */
+    int window_size;
+    int hop_size;
+    darktuna_detector detector;
+    /* Non-zero for the adaptive noise gate, else rms_threshold is used */
+    int adaptive_gate;
+    float rms_threshold;
+    /* 50 or 60 to notch mains hum, 0 to disable */
+    float mains_frequency;
+    /* Cutoff of the optional high-pass, 0 to disable */
+    float high_pass_frequency;
+    /* Since 1.1, float when an older struct leaves it out */
+    darktuna_accumulation accumulation;
+} darktuna_config;
+
+typedef struct darktuna_result {
+    size_t struct_size;
+    /* Input sample count at the end of the analyzed window */
+    long long sample_index;
+    float rms;
+    int voiced;
+    /* 0 and NULL when nothing in range was detected */
+    float frequency;
+    float confidence;
+    const char *note_name;
+    float note_frequency;
+    float cents_off;
+    /* Since 1.2, capture time of the newest sample in the analyzed window,
+     * on the clock passed to darktuna_process_timed */
+    double input_time;
+} darktuna_result;
+
+/* Fills in the defaults, the GUI uses the same ones */
+void darktuna_config_init(darktuna_config *config);
+void darktuna_result_init(darktuna_result *result);
+
+/* Returns NULL if the config is invalid */
+darktuna_tuner *darktuna_create(const darktuna_config *config);
+void darktuna_destroy(darktuna_tuner *tuner);
+
+/*
+ * Feeds count samples. Returns 1 and fills result when at least one window
+ * was analyzed (the newest one), 0 when more input is needed and -1 on
+ * invalid arguments.
+ */
+int darktuna_process(darktuna_tuner *tuner, const float *samples, int count, darktuna_result *result);
+
+/*
+ * Same, with the capture time of samples[0] in seconds, for example the
+ * inputBufferAdcTime of a PortAudio callback. result->input_time is then on
+ * that clock, so the caller can tell how old a reading is. Since 1.2.
+ */
+int darktuna_process_timed(darktuna_tuner *tuner, const float *samples, int count, double time,
+    darktuna_result *result);
+
+/*
+ * Same, for 16 bit capture. The samples are converted as the pipeline takes
+ * them in, so this doesn't allocate either. Since 1.3.
+ */
+int darktuna_process_int16(darktuna_tuner *tuner, const short *samples, int count, double time,
+    darktuna_result *result);
+
+/* Drops all buffered audio and filter state, keeps the config. Allocates,
+ * so don't call it from the audio thread. */
+void darktuna_reset(darktuna_tuner *tuner);
+
+int darktuna_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DARKTUNA_H */